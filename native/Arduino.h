@@ -0,0 +1,57 @@
+/*******************************************************************************
+ *
+ *  File:         Arduino.h
+ *
+ *  Function:     Minimal Arduino core stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Provides only the parts of the Arduino core API that are
+ *                used by LMIC-node so that LMIC-node.cpp can be compiled
+ *                and run on the host (PlatformIO native platform).
+ *                Time is virtual and is driven by the LMIC simulator
+ *                (see lmic-sim.cpp), delay() advances the virtual clock.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LMIC_NODE_NATIVE_ARDUINO
+#define ARDUINO_ARCH_NATIVE
+
+#define PROGMEM
+#define memcpy_P memcpy
+
+#define HIGH 1
+#define LOW  0
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+#include "Print.h"
+#include "WString.h"
+#include "HardwareSerial.h"
+
+#endif  // ARDUINO_H_
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ *
+ *  File:         EEPROM.h
+ *
+ *  Function:     Arduino EEPROM library stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Behaves like the flash emulated EEPROM of ESP32/ESP8266
+ *                (begin(size) and commit()). Content is kept in memory and
+ *                survives simulated resets. If a storage file is given
+ *                (simulator option -e) content is loaded from and committed
+ *                to that file, so it also persists between simulator runs.
+ *                Commits and writes per byte are counted to measure wear.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include <stdint.h>
+
+class EEPROMClass
+{
+public:
+    static const uint16_t MaxSize = 4096;
+
+    bool begin(uint16_t size);
+    uint8_t read(int address) const;
+    void write(int address, uint8_t value);
+    bool commit(void);
+    uint16_t length(void) const { return size_; }
+
+    // Simulator statistics
+    unsigned long commits() const { return commits_; }
+    unsigned long maxWritesPerByte() const;
+
+private:
+    uint16_t size_ = 0;
+    bool loaded_ = false;
+    bool changed_ = false;
+    uint8_t data_[MaxSize];
+    unsigned long writes_[MaxSize] = {};
+    unsigned long commits_ = 0;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif  // EEPROM_H_
@@ -0,0 +1,44 @@
+/*******************************************************************************
+ *
+ *  File:         EasyLed.h
+ *
+ *  Function:     EasyLed stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Only keeps track of the LED state.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef EASYLED_H_
+#define EASYLED_H_
+
+#include <stdint.h>
+
+class EasyLed
+{
+public:
+    enum class ActiveLevel { Low = 0, High = 1 };
+    enum class State { Off = 0, On = 1 };
+
+    EasyLed(uint8_t pin, ActiveLevel activeLevel, State initialState = State::Off)
+        : state_(initialState) { (void)pin; (void)activeLevel; }
+
+    void on() { state_ = State::On; }
+    void off() { state_ = State::Off; }
+    void toggle() { state_ = isOn() ? State::Off : State::On; }
+    bool isOn() const { return state_ == State::On; }
+    bool isOff() const { return state_ == State::Off; }
+    State getState() const { return state_; }
+
+private:
+    State state_;
+};
+
+#endif  // EASYLED_H_
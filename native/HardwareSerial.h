@@ -0,0 +1,68 @@
+/*******************************************************************************
+ *
+ *  File:         HardwareSerial.h
+ *
+ *  Function:     Arduino HardwareSerial stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Serial output is written to stdout unless the simulator
+ *                is run in quiet mode.
+ *
+ *                The transmit FIFO of a UART is modeled on the virtual
+ *                clock: it drains at the configured baud rate and a write
+ *                to a full FIFO blocks (advances the virtual clock) like
+ *                on a board. Written bytes and time spent blocked are
+ *                counted, so the cost of serial output can be measured.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef HARDWARESERIAL_H_
+#define HARDWARESERIAL_H_
+
+#include <stdint.h>
+#include "Print.h"
+
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long speed);
+    void end(void) {}
+    void flush(void);
+    int available(void) { return 0; }
+    int availableForWrite(void);
+    operator bool() const { return true; }
+
+    size_t write(uint8_t ch) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    // Simulator statistics
+    void setEcho(bool echo) { echo_ = echo; }
+    unsigned long speed() const { return speed_; }
+    unsigned long long bytesWritten() const { return bytesWritten_; }
+    unsigned long long wireTimeUs() const;
+    unsigned long long blockedUs() const { return blockedUs_; }
+
+    static const int TxFifoSize = 64;
+
+private:
+    bool echo_ = true;
+    unsigned long speed_ = 115200;
+    unsigned long long bytesWritten_ = 0;
+    unsigned long long blockedUs_ = 0;
+    unsigned long long fifoEmptyAtUs_ = 0;
+
+    unsigned long byteTimeUs() const { return 10000000UL / speed_; }
+    void transmit(uint8_t ch);
+};
+
+extern HardwareSerial Serial;
+
+#endif  // HARDWARESERIAL_H_
@@ -0,0 +1,70 @@
+/*******************************************************************************
+ *
+ *  File:         Print.h
+ *
+ *  Function:     Arduino Print class stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Implements the print()/println() overloads used by LMIC-node
+ *                on top of a single virtual write() like the Arduino core does.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef PRINT_H_
+#define PRINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class __FlashStringHelper;
+class String;
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t ch) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str);
+
+    size_t print(const __FlashStringHelper* str);
+    size_t print(const String& str);
+    size_t print(const char str[]);
+    size_t print(char ch);
+    size_t print(unsigned char value, int base = DEC_BASE);
+    size_t print(int value, int base = DEC_BASE);
+    size_t print(unsigned int value, int base = DEC_BASE);
+    size_t print(long value, int base = DEC_BASE);
+    size_t print(unsigned long value, int base = DEC_BASE);
+    size_t print(long long value, int base = DEC_BASE);
+    size_t print(unsigned long long value, int base = DEC_BASE);
+    size_t print(double value, int digits = 2);
+
+    size_t println(const __FlashStringHelper* str);
+    size_t println(const String& str);
+    size_t println(const char str[]);
+    size_t println(char ch);
+    size_t println(unsigned char value, int base = DEC_BASE);
+    size_t println(int value, int base = DEC_BASE);
+    size_t println(unsigned int value, int base = DEC_BASE);
+    size_t println(long value, int base = DEC_BASE);
+    size_t println(unsigned long value, int base = DEC_BASE);
+    size_t println(long long value, int base = DEC_BASE);
+    size_t println(unsigned long long value, int base = DEC_BASE);
+    size_t println(double value, int digits = 2);
+    size_t println(void);
+
+private:
+    static const int DEC_BASE = 10;
+    size_t printNumber(unsigned long long value, int base);
+};
+
+#endif  // PRINT_H_
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ *
+ *  File:         U8x8lib.h
+ *
+ *  Function:     U8x8 display stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Keeps the 16x8 character tile grid in memory instead of
+ *                driving an SSD1306. Every tile that would be transferred
+ *                to the panel is counted (8 bytes per tile) and advances
+ *                the virtual clock by its transfer time on a 400 kHz I2C
+ *                bus, so the I2C traffic caused by display updates and its
+ *                effect on LMIC timing can be measured.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef U8X8LIB_H_
+#define U8X8LIB_H_
+
+#include <stdint.h>
+#include "Print.h"
+
+#define U8X8_PIN_NONE 255
+
+extern const uint8_t u8x8_font_victoriamedium8_r[];
+
+class U8X8 : public Print
+{
+public:
+    static const uint8_t Cols = 16;
+    static const uint8_t Rows = 8;
+    static const uint8_t TileBytes = 8;
+    static const uint32_t I2cSpeed = 400000;    // Simulated bus speed (Hz)
+
+    bool begin(void);
+    void setFont(const uint8_t* font) { (void)font; }
+    void clear(void);
+    void clearLine(uint8_t line);
+    void setCursor(uint8_t x, uint8_t y) { tx_ = x; ty_ = y; }
+    uint8_t drawGlyph(uint8_t x, uint8_t y, uint8_t encoding);
+    uint8_t drawString(uint8_t x, uint8_t y, const char* s);
+    void drawTile(uint8_t x, uint8_t y, uint8_t cnt, uint8_t* tile_ptr);
+
+    size_t write(uint8_t ch) override;
+    using Print::write;
+
+    // Simulator statistics
+    char charAt(uint8_t x, uint8_t y) const { return tiles_[y][x]; }
+    unsigned long long tilesSent() const { return tilesSent_; }
+    unsigned long long bytesSent() const { return tilesSent_ * TileBytes; }
+
+private:
+    uint8_t tx_ = 0;
+    uint8_t ty_ = 0;
+    char tiles_[Rows][Cols] = {};
+    unsigned long long tilesSent_ = 0;
+};
+
+class U8X8_SSD1306_128X64_NONAME_HW_I2C : public U8X8
+{
+public:
+    U8X8_SSD1306_128X64_NONAME_HW_I2C(uint8_t reset = U8X8_PIN_NONE,
+                                      uint8_t clock = U8X8_PIN_NONE,
+                                      uint8_t data = U8X8_PIN_NONE)
+    {
+        (void)reset; (void)clock; (void)data;
+    }
+};
+
+#endif  // U8X8LIB_H_
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ *
+ *  File:         WString.h
+ *
+ *  Function:     Arduino String class stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Heap based like the Arduino String class so that
+ *                allocations made via String are visible in the
+ *                allocation counters reported by the simulator.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef WSTRING_H_
+#define WSTRING_H_
+
+#include <stddef.h>
+
+class String
+{
+public:
+    String(const char* str = "");
+    String(const String& other);
+    explicit String(char ch);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator=(const char* str);
+
+    bool concat(const String& str);
+    bool concat(const char* str);
+    bool concat(char ch);
+    bool concat(int value);
+    bool concat(unsigned int value);
+    bool concat(long value);
+    bool concat(unsigned long value);
+
+    unsigned int length(void) const { return len_; }
+    const char* c_str() const { return buffer_ ? buffer_ : ""; }
+
+private:
+    char* buffer_ = nullptr;
+    unsigned int capacity_ = 0;
+    unsigned int len_ = 0;
+
+    bool reserve(unsigned int size);
+    bool append(const char* str, unsigned int length);
+};
+
+#endif  // WSTRING_H_
@@ -0,0 +1,35 @@
+/*******************************************************************************
+ *
+ *  File:         Wire.h
+ *
+ *  Function:     Arduino Wire (I2C) stand-in for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  The simulated display does not use I2C. Only provided
+ *                so that sources that include Wire.h compile.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef WIRE_H_
+#define WIRE_H_
+
+#include <stdint.h>
+
+class TwoWire
+{
+public:
+    void begin(void) {}
+    void begin(int sda, int scl) { (void)sda; (void)scl; }
+    void setClock(uint32_t frequency) { (void)frequency; }
+};
+
+extern TwoWire Wire;
+
+#endif  // WIRE_H_
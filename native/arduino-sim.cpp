@@ -0,0 +1,469 @@
+/*******************************************************************************
+ *
+ *  File:         arduino-sim.cpp
+ *
+ *  Function:     Arduino core stand-in implementation for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Print, String, HardwareSerial, U8x8 display and timing
+ *                functions. Also replaces the global operator new so that
+ *                heap allocations made by the application can be counted.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <new>
+#include "Arduino.h"
+#include "Wire.h"
+#include "EEPROM.h"
+#include "U8x8lib.h"
+#include "lmic-sim.h"
+
+
+// -----------------------------------------------------------------------------
+// Heap allocation counters
+
+static uint64_t allocationCount_ = 0;
+static uint64_t allocatedBytes_ = 0;
+
+uint64_t simAllocationCount(void) { return allocationCount_; }
+uint64_t simAllocatedBytes(void) { return allocatedBytes_; }
+
+void* operator new(size_t size)
+{
+    ++allocationCount_;
+    allocatedBytes_ += size;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+
+// -----------------------------------------------------------------------------
+// Timing
+
+unsigned long millis(void) { return (unsigned long)(simTimeUs() / 1000); }
+unsigned long micros(void) { return (unsigned long)simTimeUs(); }
+void delay(unsigned long ms) { simAdvanceUs((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { simAdvanceUs(us); }
+
+
+// -----------------------------------------------------------------------------
+// Print
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::write(const char* str)
+{
+    return str == nullptr ? 0 : write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+}
+
+size_t Print::printNumber(unsigned long long value, int base)
+{
+    char buf[8 * sizeof(value) + 1];
+    char* p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    if (base < 2)
+    {
+        base = 10;
+    }
+    do
+    {
+        char digit = value % base;
+        value /= base;
+        *--p = digit < 10 ? digit + '0' : digit + 'A' - 10;
+    } while (value);
+    return write(p);
+}
+
+size_t Print::print(const __FlashStringHelper* str) { return write(reinterpret_cast<const char*>(str)); }
+size_t Print::print(const String& str) { return write(str.c_str()); }
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char ch) { return write((uint8_t)ch); }
+size_t Print::print(unsigned char value, int base) { return printNumber(value, base); }
+size_t Print::print(int value, int base) { return print((long long)value, base); }
+size_t Print::print(unsigned int value, int base) { return printNumber(value, base); }
+size_t Print::print(long value, int base) { return print((long long)value, base); }
+size_t Print::print(unsigned long value, int base) { return printNumber(value, base); }
+size_t Print::print(unsigned long long value, int base) { return printNumber(value, base); }
+
+size_t Print::print(long long value, int base)
+{
+    if (base == 10 && value < 0)
+    {
+        return print('-') + printNumber(0ULL - (unsigned long long)value, 10);
+    }
+    return printNumber((unsigned long long)value, base);
+}
+
+size_t Print::print(double value, int digits)
+{
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return write(buf);
+}
+
+size_t Print::println(void) { return write("\r\n"); }
+size_t Print::println(const __FlashStringHelper* str) { return print(str) + println(); }
+size_t Print::println(const String& str) { return print(str) + println(); }
+size_t Print::println(const char str[]) { return print(str) + println(); }
+size_t Print::println(char ch) { return print(ch) + println(); }
+size_t Print::println(unsigned char value, int base) { return print(value, base) + println(); }
+size_t Print::println(int value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned int value, int base) { return print(value, base) + println(); }
+size_t Print::println(long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long value, int base) { return print(value, base) + println(); }
+size_t Print::println(long long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long long value, int base) { return print(value, base) + println(); }
+size_t Print::println(double value, int digits) { return print(value, digits) + println(); }
+
+
+// -----------------------------------------------------------------------------
+// String
+
+String::String(const char* str) { *this = str; }
+String::String(const String& other) { *this = other; }
+String::String(char ch) { append(&ch, 1); }
+String::String(int value, unsigned char base) : String((long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base)
+{
+    char buf[2 + 8 * sizeof(long)];
+    if (base == 10)
+    {
+        snprintf(buf, sizeof(buf), "%ld", value);
+    }
+    else
+    {
+        snprintf(buf, sizeof(buf), base == 16 ? "%lX" : "%lo", (unsigned long)value);
+    }
+    append(buf, strlen(buf));
+}
+
+String::String(unsigned long value, unsigned char base)
+{
+    char buf[1 + 8 * sizeof(unsigned long)];
+    snprintf(buf, sizeof(buf), base == 16 ? "%lX" : base == 8 ? "%lo" : "%lu", value);
+    append(buf, strlen(buf));
+}
+
+String::~String() { delete[] buffer_; }
+
+String& String::operator=(const String& other)
+{
+    if (this != &other)
+    {
+        len_ = 0;
+        append(other.c_str(), other.length());
+    }
+    return *this;
+}
+
+String& String::operator=(const char* str)
+{
+    len_ = 0;
+    if (str != nullptr)
+    {
+        append(str, strlen(str));
+    }
+    return *this;
+}
+
+bool String::reserve(unsigned int size)
+{
+    if (size + 1 <= capacity_)
+    {
+        return true;
+    }
+    char* buffer = new char[size + 1];
+    if (buffer_ != nullptr)
+    {
+        memcpy(buffer, buffer_, len_ + 1);
+        delete[] buffer_;
+    }
+    buffer_ = buffer;
+    capacity_ = size + 1;
+    return true;
+}
+
+bool String::append(const char* str, unsigned int length)
+{
+    reserve(len_ + length);
+    memcpy(buffer_ + len_, str, length);
+    len_ += length;
+    buffer_[len_] = '\0';
+    return true;
+}
+
+bool String::concat(const String& str) { return append(str.c_str(), str.length()); }
+bool String::concat(const char* str) { return str != nullptr && append(str, strlen(str)); }
+bool String::concat(char ch) { return append(&ch, 1); }
+bool String::concat(int value) { return concat(String(value)); }
+bool String::concat(unsigned int value) { return concat(String(value)); }
+bool String::concat(long value) { return concat(String(value)); }
+bool String::concat(unsigned long value) { return concat(String(value)); }
+
+
+// -----------------------------------------------------------------------------
+// HardwareSerial
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long speed)
+{
+    speed_ = speed;
+}
+
+void HardwareSerial::flush(void)
+{
+    if (echo_)
+    {
+        fflush(stdout);
+    }
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+    uint64_t now = simTimeUs();
+    if (fifoEmptyAtUs_ <= now)
+    {
+        return TxFifoSize;
+    }
+    int queued = (int)((fifoEmptyAtUs_ - now + byteTimeUs() - 1) / byteTimeUs());
+    return queued >= TxFifoSize ? 0 : TxFifoSize - queued;
+}
+
+void HardwareSerial::transmit(uint8_t ch)
+{
+    if (availableForWrite() == 0)
+    {
+        // FIFO full: block until there is room for one byte.
+        uint64_t waitUs = fifoEmptyAtUs_ - simTimeUs() - (uint64_t)(TxFifoSize - 1) * byteTimeUs();
+        blockedUs_ += waitUs;
+        simAdvanceUs(waitUs);
+    }
+    uint64_t now = simTimeUs();
+    fifoEmptyAtUs_ = (fifoEmptyAtUs_ > now ? fifoEmptyAtUs_ : now) + byteTimeUs();
+    ++bytesWritten_;
+    if (echo_)
+    {
+        // Written unmodified, output may contain binary log records.
+        putchar(ch);
+    }
+}
+
+size_t HardwareSerial::write(uint8_t ch)
+{
+    transmit(ch);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        transmit(buffer[i]);
+    }
+    return size;
+}
+
+unsigned long long HardwareSerial::wireTimeUs() const
+{
+    // 10 bits per byte (start bit, 8 data bits, stop bit).
+    return bytesWritten_ * 10ULL * 1000000ULL / speed_;
+}
+
+
+// -----------------------------------------------------------------------------
+// EEPROM
+
+EEPROMClass EEPROM;
+
+bool EEPROMClass::begin(uint16_t size)
+{
+    size_ = size < MaxSize ? size : MaxSize;
+    if (!loaded_)
+    {
+        // Erased state. Content is kept over simulated resets.
+        memset(data_, 0xFF, sizeof(data_));
+        if (simConfig.storageFile != nullptr)
+        {
+            FILE* file = fopen(simConfig.storageFile, "rb");
+            if (file != nullptr)
+            {
+                size_t length = fread(data_, 1, sizeof(data_), file);
+                (void)length;
+                fclose(file);
+            }
+        }
+        loaded_ = true;
+    }
+    return true;
+}
+
+uint8_t EEPROMClass::read(int address) const
+{
+    return address >= 0 && address < size_ ? data_[address] : 0xFF;
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+    if (address >= 0 && address < size_)
+    {
+        data_[address] = value;
+        ++writes_[address];
+        changed_ = true;
+    }
+}
+
+bool EEPROMClass::commit(void)
+{
+    if (!changed_)
+    {
+        return true;
+    }
+    ++commits_;
+    changed_ = false;
+    if (simConfig.storageFile != nullptr)
+    {
+        FILE* file = fopen(simConfig.storageFile, "wb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        fwrite(data_, 1, size_, file);
+        fclose(file);
+    }
+    return true;
+}
+
+unsigned long EEPROMClass::maxWritesPerByte() const
+{
+    unsigned long max = 0;
+    for (uint16_t i = 0; i < size_; ++i)
+    {
+        if (writes_[i] > max)
+        {
+            max = writes_[i];
+        }
+    }
+    return max;
+}
+
+
+// -----------------------------------------------------------------------------
+// Wire
+
+TwoWire Wire;
+
+
+// -----------------------------------------------------------------------------
+// U8x8
+
+const uint8_t u8x8_font_victoriamedium8_r[] = { 0 };
+
+static uint64_t displayTilesSent_ = 0;
+
+uint64_t simDisplayBytes(void) { return displayTilesSent_ * U8X8::TileBytes; }
+
+static void sendTiles(uint8_t count)
+{
+    // Transfers take time: 9 bits per byte (incl. ACK) at I2C bus speed.
+    displayTilesSent_ += count;
+    simAdvanceUs((uint64_t)count * U8X8::TileBytes * 9 * 1000000 / U8X8::I2cSpeed);
+}
+
+bool U8X8::begin(void)
+{
+    clear();
+    return true;
+}
+
+void U8X8::clear(void)
+{
+    for (uint8_t row = 0; row < Rows; ++row)
+    {
+        clearLine(row);
+    }
+    tx_ = 0;
+    ty_ = 0;
+}
+
+void U8X8::clearLine(uint8_t line)
+{
+    if (line < Rows)
+    {
+        memset(tiles_[line], ' ', Cols);
+        tilesSent_ += Cols;
+        sendTiles(Cols);
+    }
+}
+
+uint8_t U8X8::drawGlyph(uint8_t x, uint8_t y, uint8_t encoding)
+{
+    if (x < Cols && y < Rows)
+    {
+        tiles_[y][x] = (char)encoding;
+        ++tilesSent_;
+        sendTiles(1);
+    }
+    return 1;
+}
+
+uint8_t U8X8::drawString(uint8_t x, uint8_t y, const char* s)
+{
+    uint8_t count = 0;
+    while (*s != '\0')
+    {
+        drawGlyph(x++, y, (uint8_t)*s++);
+        ++count;
+    }
+    return count;
+}
+
+void U8X8::drawTile(uint8_t x, uint8_t y, uint8_t cnt, uint8_t* tile_ptr)
+{
+    (void)tile_ptr;
+    for (uint8_t i = 0; i < cnt; ++i)
+    {
+        if (x + i < Cols && y < Rows)
+        {
+            tiles_[y][x + i] = '\x7f';  // Graphic tile
+            ++tilesSent_;
+            sendTiles(1);
+        }
+    }
+}
+
+size_t U8X8::write(uint8_t ch)
+{
+    if (ch == '\n' || ch == '\r')
+    {
+        return 1;
+    }
+    drawGlyph(tx_++, ty_, ch);
+    return 1;
+}
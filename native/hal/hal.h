@@ -0,0 +1,39 @@
+/*******************************************************************************
+ *
+ *  File:         hal.h
+ *
+ *  Function:     Simulated LMIC hardware abstraction layer interface.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Pin map definition as used in the Board Support Files.
+ *                The pin map is not used by the simulator.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef LMIC_SIM_HAL_H_
+#define LMIC_SIM_HAL_H_
+
+#include <stdint.h>
+
+static const uint8_t NUM_DIO = 3;
+static const uint8_t LMIC_UNUSED_PIN = 0xff;
+
+struct lmic_pinmap
+{
+    uint8_t nss;
+    uint8_t rxtx;
+    uint8_t rst;
+    uint8_t dio[NUM_DIO];
+    uint8_t rxtx_rx_active;
+    int8_t rssi_cal;
+    uint32_t spi_freq;
+};
+
+#endif  // LMIC_SIM_HAL_H_
@@ -0,0 +1,1058 @@
+/*******************************************************************************
+ *
+ *  File:         lmic-sim.cpp
+ *
+ *  Function:     Simulated LMIC library, virtual clock and main() for the
+ *                host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Implements the os_ job scheduler and LMIC_ functions
+ *                declared in lmic.h on top of a virtual clock.
+ *
+ *                Uplinks are 'transmitted' by a chain of internal jobs that
+ *                follow the LoRaWAN class A timing: EV_TXSTART, time-on-air
+ *                for the current data rate, RX1 and RX2 windows (EV_RXSTART)
+ *                and EV_TXCOMPLETE. A 1% duty cycle is enforced between
+ *                transmissions. Joins, downlinks, acks and failed join
+ *                attempts are injected according to the simulator settings.
+ *
+ *                main() calls setup() and then calls loop() until the
+ *                simulated run time has elapsed, after which it prints
+ *                run statistics to stderr.
+ *
+ *                Usage: program [-t seconds] [-q] [-s seed] [-j failed-joins]
+ *                               [-d downlink-every-n-uplinks] [-a ack-percent]
+ *                               [-r join-datarate] [-R reset-every-n-seconds]
+ *                               [-e storage-file] [-A adr-step-every-n-uplinks]
+ *                               [-x downlink-hex-payload] [-p downlink-port]
+ *                               [-f forget-session-after-n-seconds]
+ *
+ *                With -R the node is reset periodically: setup() is called
+ *                again while the simulated network keeps its state and
+ *                rejects uplinks with an unknown DevAddr or a frame counter
+ *                that is not higher than the last one it accepted.
+ *
+ *                With -A the network lowers the data rate one step (down to
+ *                SF12) every n uplinks, like ADR does when the link degrades.
+ *                The LinkADRAns response (2 bytes) is piggybacked in FOpts
+ *                of the next uplink, which reduces its max payload length.
+ *
+ *                With -f the network forgets the session (e.g. the device was
+ *                removed and added again) and rejects all its uplinks. As in
+ *                MCCI LMIC, when link check validation is enabled the node sets
+ *                ADRACKReq after LINK_CHECK_INIT uplinks without downlink, and
+ *                reports EV_LINK_DEAD (and lowers the data rate) when the 
+ *                network has not answered within LINK_CHECK_DEAD more uplinks.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include "Arduino.h"
+#include "U8x8lib.h"
+#include "EEPROM.h"
+#include "lmic-sim.h"
+
+
+SimConfig simConfig;
+SimStats simStats;
+struct lmic_t LMIC;
+
+
+// -----------------------------------------------------------------------------
+// Virtual clock
+
+static uint64_t nowUs_ = 0;
+
+uint64_t simTimeUs(void)
+{
+    return nowUs_;
+}
+
+void simAdvanceUs(uint64_t us)
+{
+    nowUs_ += us;
+}
+
+void simSleepUs(uint64_t us)
+{
+    nowUs_ += us;
+    simStats.sleepUs += us;
+}
+
+static const uint64_t IdleStepUs = 1000;
+
+static void simIdleUs(uint64_t us)
+{
+    nowUs_ += us;
+    simStats.idleUs += us;
+}
+
+ostime_t os_getTime(void)
+{
+    return (ostime_t)(uint32_t)(nowUs_ * OSTICKS_PER_SEC / 1000000);
+}
+
+
+// -----------------------------------------------------------------------------
+// Pseudo random generator (xorshift32), deterministic for a given seed.
+
+static uint32_t randomState_ = 1;
+
+static uint32_t simRandom(void)
+{
+    randomState_ ^= randomState_ << 13;
+    randomState_ ^= randomState_ >> 17;
+    randomState_ ^= randomState_ << 5;
+    return randomState_;
+}
+
+static uint32_t simRandom(uint32_t range)
+{
+    return range == 0 ? 0 : simRandom() % range;
+}
+
+
+// -----------------------------------------------------------------------------
+// Job scheduler
+
+static osjob_t* runnableJobs_ = nullptr;
+static osjob_t* scheduledJobs_ = nullptr;
+
+static bool unlinkJob(osjob_t** pnext, osjob_t* job)
+{
+    for (; *pnext != nullptr; pnext = &((*pnext)->next))
+    {
+        if (*pnext == job)
+        {
+            *pnext = job->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+void os_init(void)
+{
+    runnableJobs_ = nullptr;
+    scheduledJobs_ = nullptr;
+}
+
+void os_clearCallback(osjob_t* job)
+{
+    if (!unlinkJob(&runnableJobs_, job))
+    {
+        unlinkJob(&scheduledJobs_, job);
+    }
+}
+
+void os_setCallback(osjob_t* job, osjobcb_t* cb)
+{
+    os_clearCallback(job);
+    job->func = cb;
+    job->next = nullptr;
+    osjob_t** pnext = &runnableJobs_;
+    while (*pnext != nullptr)
+    {
+        pnext = &((*pnext)->next);
+    }
+    *pnext = job;
+}
+
+void os_setTimedCallback(osjob_t* job, ostime_t time, osjobcb_t* cb)
+{
+    os_clearCallback(job);
+    job->deadline = time;
+    job->func = cb;
+    job->next = nullptr;
+    osjob_t** pnext = &scheduledJobs_;
+    while (*pnext != nullptr && (s4_t)((*pnext)->deadline - time) <= 0)
+    {
+        pnext = &((*pnext)->next);
+    }
+    job->next = *pnext;
+    *pnext = job;
+}
+
+bit_t os_queryTimeCriticalJobs(ostime_t time)
+{
+    // Returns true if a job is scheduled at or before (absolute) time.
+    return scheduledJobs_ != nullptr
+           && (s4_t)(scheduledJobs_->deadline - time) <= 0;
+}
+
+void os_runloop_once(void)
+{
+    osjob_t* job = nullptr;
+    if (runnableJobs_ != nullptr)
+    {
+        job = runnableJobs_;
+        runnableJobs_ = job->next;
+    }
+    else if (scheduledJobs_ != nullptr)
+    {
+        s4_t ticksLeft = (s4_t)(scheduledJobs_->deadline - os_getTime());
+        if (ticksLeft <= 0)
+        {
+            job = scheduledJobs_;
+            scheduledJobs_ = job->next;
+        }
+        else
+        {
+            // Nothing due: advance the virtual clock towards the next deadline.
+            // On a real MCU loop() keeps spinning while idle, so advance
+            // in small steps to give loop() the same opportunities.
+            uint64_t us = ((uint64_t)ticksLeft * 1000000 + OSTICKS_PER_SEC - 1) / OSTICKS_PER_SEC;
+            simIdleUs(us < IdleStepUs ? us : IdleStepUs);
+        }
+    }
+    else
+    {
+        simIdleUs(IdleStepUs);
+    }
+
+    if (job != nullptr)
+    {
+        ++simStats.jobsRun;
+        job->func(job);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Radio and MAC simulation (EU868)
+
+static const uint8_t FrameOverhead = 13;        // MHDR + FHDR + FPort + MIC
+static const uint8_t JoinRequestLength = 23;
+static const uint8_t DownlinkDataBeg = 9;       // MHDR + FHDR + FPort
+static const uint32_t RxWindowUs = 25000;       // RX window open without preamble
+static const uint16_t DutyCycleFactor = 99;     // 1% duty cycle
+static const uint32_t RxLateUs = 1000;          // RX window opened too late
+static const int16_t MobilityRangeTenfold = 240; // SNR decrease at the far end of the route (0.1 dB)
+static const s1_t ReferenceTxPower = 14;        // TX power (dBm) at which the link SNR is received
+
+static const uint32_t channelFrequencies[] = {
+    868100000, 868300000, 868500000, 867100000,
+    867300000, 867500000, 867700000, 867900000
+};
+static const uint8_t DefaultChannels = 3;      // Channels 3-7 are added by join-accept CFList
+
+static osjob_t radioJob_;
+static uint64_t txAvailableUs_ = 0;
+static uint32_t joinAttemptsFailed_ = 0;
+static bool joinTx_ = false;
+static uint32_t joinTxCount_ = 0;
+static bool downlinkQueued_ = false;
+static uint8_t downlinkPort_ = 0;
+static uint8_t downlinkLength_ = 0;
+static uint8_t downlinkData_[MAX_LEN_PAYLOAD];
+
+// Network side: the session it knows and the last uplink frame counter it accepted.
+static devaddr_t networkDevAddr_ = 0;
+static int64_t networkSeqnoUp_ = -1;
+static bool networkForgotten_ = false;
+static bool uplinkAccepted_ = false;
+
+// Link budget of the current uplink.
+static int16_t linkRssi_ = 0;
+static int16_t linkSnrTenfold_ = 0;
+static int16_t uplinkMarginTenfold_ = 0;       // Above the demodulation floor of the data rate
+static bool linkCheckRequested_ = false;
+static bool adrAckRequested_ = false;
+
+// Data frame built by LMIC_setTxData2() (as MCCI LMIC) when it could be sent right away.
+static bool frameBuilt_ = false;
+static uint8_t frameLength_ = 0;
+
+static int16_t demodulationFloorTenfold(dr_t dr)
+{
+    // Lowest SNR at which the gateway receives the data rate: -7.5 dB for SF7
+    // down to -20 dB for SF12.
+    return -75 - 25 * (getSf(updr2rps(dr)) - SF7);
+}
+
+static void simUpdateLink(void)
+{
+    // A mobile node (-m) moves away from the gateway and back, 
+    // which lowers the SNR and RSSI by up to 24 dB.
+    int16_t variation = simConfig.signalVariation != 0 
+                        ? (int16_t)simRandom(2 * simConfig.signalVariation + 1) - simConfig.signalVariation : 0;
+    int16_t mobility = 0;
+    if (simConfig.mobilityPeriod != 0)
+    {
+        uint32_t phase = (uint32_t)(nowUs_ / 1000000) % simConfig.mobilityPeriod;
+        uint32_t half = simConfig.mobilityPeriod / 2 != 0 ? simConfig.mobilityPeriod / 2 : 1;
+        uint32_t distance = phase < half ? phase : simConfig.mobilityPeriod - phase;
+        mobility = -(int16_t)((int32_t)MobilityRangeTenfold * distance / half);
+    }
+    linkRssi_ = simConfig.rssi + variation + mobility / 10;
+    linkSnrTenfold_ = simConfig.snrTenfold + variation * 5 + mobility;
+}
+
+static bool simLinkCheckRequested(void)
+{
+    // Looks for a LinkCheckReq in the MAC commands sent with the uplink.
+    for (uint8_t i = 0; i < LMIC.pendMacLen && i < sizeof(LMIC.pendMacData); )
+    {
+        if (LMIC.pendMacData[i] == MCMD_LinkCheckReq)
+        {
+            return true;
+        }
+        if (LMIC.pendMacData[i] != MCMD_LinkADRAns)
+        {
+            break;
+        }
+        i += 2;
+    }
+    return false;
+}
+
+static void reportEvent(ev_t ev)
+{
+    ++simStats.events;
+    if (LMIC.client_eventCb != nullptr)
+    {
+        LMIC.client_eventCb(LMIC.client_eventUserData, ev);
+    }
+    else if (onEvent)
+    {
+        onEvent(ev);
+    }
+}
+
+static uint8_t maxPayloadLength(dr_t dataRate)
+{
+    // Max application payload per data rate, EU868 (without FOpts).
+    return dataRate <= DR_SF10 ? 51 : dataRate == DR_SF9 ? 115 : 222;
+}
+
+uint64_t simAirtimeUs(dr_t dataRate, uint8_t payloadLength)
+{
+    // LoRa time-on-air per SX1276 datasheet §4.1.1.7, explicit header,
+    // CRC on, coding rate 4/5, 8 preamble symbols.
+    uint8_t sf = dataRate <= DR_SF7 ? 12 - dataRate : 7;
+    uint32_t bandwidth = dataRate == DR_SF7B ? 250000 : 125000;
+    uint8_t lowDataRateOptimize = (sf >= 11 && bandwidth == 125000) ? 1 : 0;
+    uint64_t symbolUs = ((uint64_t)1000000 << sf) / bandwidth;
+
+    int32_t numerator = 8 * payloadLength - 4 * sf + 28 + 16;
+    int32_t denominator = 4 * (sf - 2 * lowDataRateOptimize);
+    int32_t payloadSymbols = 8;
+    if (numerator > 0)
+    {
+        payloadSymbols += ((numerator + denominator - 1) / denominator) * 5;
+    }
+    // Preamble is 8 + 4.25 symbols.
+    return (symbolUs * 49) / 4 + symbolUs * payloadSymbols;
+}
+
+void simQueueDownlink(uint8_t fPort, const uint8_t* data, uint8_t length)
+{
+    downlinkPort_ = fPort;
+    downlinkLength_ = length > sizeof(downlinkData_) ? sizeof(downlinkData_) : length;
+    memcpy(downlinkData_, data, downlinkLength_);
+    downlinkQueued_ = true;
+}
+
+static void scheduleRadioJob(uint64_t atUs, osjobcb_t* cb)
+{
+    uint64_t delayUs = atUs > nowUs_ ? atUs - nowUs_ : 0;
+    os_setTimedCallback(&radioJob_, (ostime_t)((uint32_t)os_getTime() + us2osticksCeil(delayUs)), cb);
+}
+
+static void startTx(void);
+
+static void joinRetryCb(osjob_t* job)
+{
+    startTx();
+}
+
+static void txCompleteCb(osjob_t* job)
+{
+    bool dataPending = (LMIC.opmode & OP_TXDATA) != 0;
+    LMIC.opmode &= ~(OP_TXRXPEND | OP_TXDATA | OP_POLL);
+    if (!joinTx_)
+    {
+        if ((LMIC.txrxFlags & (TXRX_DNW1 | TXRX_DNW2)) == 0 && LMIC.adrAckReq > LINK_CHECK_DEAD)
+        {
+            // As MCCI LMIC: no answer to ADRACKReq, lower the data rate
+            // and report the link dead before EV_TXCOMPLETE.
+            if (LMIC.datarate > DR_SF12)
+            {
+                --LMIC.datarate;
+            }
+            LMIC.adrAckReq = LINK_CHECK_CONT;
+            LMIC.opmode |= OP_LINKDEAD;
+            ++simStats.linkDead;
+            reportEvent(EV_LINK_DEAD);
+        }
+        reportEvent(EV_TXCOMPLETE);
+        return;
+    }
+
+    if (LMIC.devaddr != 0)
+    {
+        LMIC.opmode &= ~OP_JOINING;
+        reportEvent(EV_JOINED);
+        if (dataPending)
+        {
+            LMIC.opmode |= OP_TXDATA;
+            startTx();
+        }
+    }
+    else
+    {
+        reportEvent(EV_JOIN_TXCOMPLETE);
+        if ((LMIC.opmode & OP_JOINING) == 0)
+        {
+            return;     // Joining stopped by the application
+        }
+        // As MCCI LMIC: lower the data rate after every second attempt,
+        // after SF12 start again at SF7.
+        if (++joinTxCount_ % 2 == 0)
+        {
+            LMIC.datarate = LMIC.datarate > DR_SF12 ? LMIC.datarate - 1 : DR_SF7;
+        }
+        // Retry after a randomized backoff (at least the duty cycle off-time).
+        uint64_t retryUs = txAvailableUs_ + simRandom(4000000);
+        if (dataPending)
+        {
+            LMIC.opmode |= OP_TXDATA;
+        }
+        LMIC.opmode |= OP_TXRXPEND;
+        scheduleRadioJob(retryUs, joinRetryCb);
+    }
+}
+
+static void acceptDownlink(bool linkCheckAns)
+{
+    // Place the downlink (if any) in LMIC.frame like the MCCI library does.
+    // MAC commands for the node are sent in the frame header (FOpts).
+    LMIC.rssi = linkRssi_ + 64;
+    LMIC.snr = (linkSnrTenfold_ * 4) / 10;
+    uint8_t optsLength = 0;
+    if (linkCheckAns)
+    {
+        // Demodulation margin of the uplink (dB) and gateway count.
+        LMIC.frame[OFF_DAT_OPTS] = MCMD_LinkCheckAns;
+        LMIC.frame[OFF_DAT_OPTS + 1] = (uint8_t)(uplinkMarginTenfold_ / 10);
+        LMIC.frame[OFF_DAT_OPTS + 2] = 1;
+        optsLength = 3;
+        ++simStats.linkChecks;
+    }
+    LMIC.frame[OFF_DAT_FCT] = optsLength;
+    if (downlinkQueued_)
+    {
+        LMIC.frame[DownlinkDataBeg + optsLength - 1] = downlinkPort_;
+        memcpy(LMIC.frame + DownlinkDataBeg + optsLength, downlinkData_, downlinkLength_);
+        LMIC.dataBeg = DownlinkDataBeg + optsLength;
+        LMIC.dataLen = downlinkLength_;
+        LMIC.txrxFlags |= TXRX_PORT;
+        downlinkQueued_ = false;
+        ++simStats.downlinks;
+    }
+    LMIC.txrxFlags |= TXRX_DNW1;
+    ++LMIC.seqnoDn;
+    if (LMIC.adrAckReq != LINK_CHECK_OFF)
+    {
+        LMIC.adrAckReq = LINK_CHECK_INIT;
+        LMIC.opmode &= ~OP_LINKDEAD;
+    }
+}
+
+static void checkRxWindowTiming(osjob_t* job)
+{
+    // The radio is set to receive after EV_RXSTART has been reported.
+    // The window opens late if the application blocked the LMIC
+    // scheduler or spent too much time in the event callback.
+    s4_t lateUs = osticks2us((s4_t)(os_getTime() - job->deadline));
+    if (lateUs > (s4_t)simStats.rxMaxLateUs)
+    {
+        simStats.rxMaxLateUs = lateUs;
+    }
+    if (lateUs > (s4_t)RxLateUs)
+    {
+        ++simStats.rxLate;
+    }
+}
+
+static void rx2Cb(osjob_t* job)
+{
+    reportEvent(EV_RXSTART);
+    checkRxWindowTiming(job);
+    if (!joinTx_ && LMIC.pendTxConf)
+    {
+        LMIC.txrxFlags |= TXRX_NACK;
+    }
+    scheduleRadioJob(nowUs_ + RxWindowUs, txCompleteCb);
+}
+
+static void rx1Cb(osjob_t* job)
+{
+    reportEvent(EV_RXSTART);
+    checkRxWindowTiming(job);
+    bool received = false;
+
+    if (joinTx_)
+    {
+        if (joinAttemptsFailed_ < simConfig.failedJoins)
+        {
+            ++joinAttemptsFailed_;
+        }
+        else if (uplinkMarginTenfold_ < 0)
+        {
+            // Join request below the demodulation floor.
+        }
+        else
+        {
+            // Join-accept received.
+            LMIC.netid = 0x13;
+            LMIC.devaddr = 0x26000000 | (simRandom() & 0x00FFFFFF);
+            LMIC.seqnoUp = 0;
+            LMIC.seqnoDn = 0;
+            if (simConfig.joinDataRate != DR_NONE)
+            {
+                LMIC.datarate = simConfig.joinDataRate;
+            }
+            for (uint8_t i = 0; i < 16; ++i)
+            {
+                LMIC.nwkKey[i] = (uint8_t)simRandom();
+                LMIC.artKey[i] = (uint8_t)simRandom();
+            }
+            // CFList with additional channels.
+            for (uint8_t channel = DefaultChannels; channel < sizeof(channelFrequencies) / sizeof(channelFrequencies[0]); ++channel)
+            {
+                LMIC_setupChannel(channel, channelFrequencies[channel], DR_RANGE_MAP(DR_SF12, DR_SF7), -1);
+            }
+            networkDevAddr_ = LMIC.devaddr;
+            networkSeqnoUp_ = -1;
+            LMIC.adrAckReq = LINK_CHECK_INIT;
+            received = true;
+        }
+    }
+    else
+    {
+        bool ack = uplinkAccepted_ && LMIC.pendTxConf && simRandom(100) < simConfig.ackPercent;
+        bool adrStep = uplinkAccepted_ && LMIC.adrEnabled && simConfig.adrStepEvery != 0 
+                       && simStats.uplinks % simConfig.adrStepEvery == 0 && LMIC.datarate > DR_SF12;
+        bool linkCheckAns = uplinkAccepted_ && linkCheckRequested_;
+        // ADRACKReq is answered with a (possibly empty) downlink.
+        bool downlink = ack || adrStep || linkCheckAns || (uplinkAccepted_ && (downlinkQueued_ || adrAckRequested_));
+        if (downlink && simConfig.downlinkLossPercent != 0 && simRandom(100) < simConfig.downlinkLossPercent)
+        {
+            // The network sends the downlink but the node does not receive it,
+            // the next received downlink shows a gap in the frame counter.
+            // A queued downlink message is sent again with the next downlink.
+            ack = adrStep = linkCheckAns = downlink = false;
+            ++LMIC.seqnoDn;
+            ++simStats.downlinksLost;
+        }
+        if (ack)
+        {
+            LMIC.txrxFlags |= TXRX_ACK;
+            ++simStats.acks;
+        }
+        if (adrStep)
+        {
+            // LinkADRReq: the answer is sent with the next uplink.
+            --LMIC.datarate;
+            LMIC.pendMacData[0] = MCMD_LinkADRAns;
+            LMIC.pendMacData[1] = 0x07;
+            LMIC.pendMacLen = 2;
+            LMIC.pendMacPiggyback = 1;
+            ++simStats.adrSteps;
+        }
+        if (downlink)
+        {
+            acceptDownlink(linkCheckAns);
+            received = true;
+        }
+    }
+
+    if (received)
+    {
+        uint8_t length = joinTx_ ? 17 : FrameOverhead + LMIC.dataLen;
+        scheduleRadioJob(nowUs_ + simAirtimeUs(LMIC.datarate, length), txCompleteCb);
+    }
+    else
+    {
+        uint64_t rx2DelayUs = joinTx_ ? 1000000 : 1000000 * LMIC.rxDelay;
+        scheduleRadioJob(nowUs_ + rx2DelayUs - RxWindowUs, rx2Cb);
+    }
+}
+
+static void txEndCb(osjob_t* job)
+{
+    LMIC.txend = os_getTime();
+    uint64_t rx1DelayUs = joinTx_ ? 5000000 : 1000000 * LMIC.rxDelay;
+    scheduleRadioJob(nowUs_ + rx1DelayUs, rx1Cb);
+}
+
+static uint8_t selectChannel(void)
+{
+    // Random enabled channel that supports the current data rate.
+    uint8_t candidates[MAX_CHANNELS];
+    uint8_t count = 0;
+    for (uint8_t channel = 0; channel < MAX_CHANNELS; ++channel)
+    {
+        if ((LMIC.channelMap & (1 << channel)) && (LMIC.channelDrMap[channel] & (1 << LMIC.datarate)))
+        {
+            candidates[count++] = channel;
+        }
+    }
+    return count != 0 ? candidates[simRandom(count)] : 0;
+}
+
+static void buildFrame(void)
+{
+    // Takes the pending MAC commands (FOpts) and the application data
+    // into the data frame.
+    linkCheckRequested_ = simLinkCheckRequested();
+    frameLength_ = FrameOverhead + LMIC.pendMacLen + LMIC.pendTxLen;
+    LMIC.pendMacLen = 0;
+    frameBuilt_ = true;
+}
+
+static void txStartCb(osjob_t* job)
+{
+    joinTx_ = (LMIC.opmode & OP_JOINING) != 0;
+    LMIC.txChnl = selectChannel();
+    LMIC.freq = LMIC.channelFreq[LMIC.txChnl] & ~(u4_t)3;
+    LMIC.txrxFlags = 0;
+    LMIC.dataBeg = 0;
+    LMIC.dataLen = 0;
+
+    uint8_t length;
+    if (joinTx_)
+    {
+        ++simStats.joinAttempts;
+        length = JoinRequestLength;
+        simUpdateLink();
+        uplinkMarginTenfold_ = linkSnrTenfold_ + (LMIC.txpow - ReferenceTxPower) * 10 
+                               - demodulationFloorTenfold(LMIC.datarate);
+    }
+    else
+    {
+        ++simStats.uplinks;
+        if (LMIC.pendTxConf)
+        {
+            ++simStats.confirmedUplinks;
+        }
+        // The gateway only receives uplinks above the demodulation floor of the data rate.
+        simUpdateLink();
+        uplinkMarginTenfold_ = linkSnrTenfold_ + (LMIC.txpow - ReferenceTxPower) * 10 
+                               - demodulationFloorTenfold(LMIC.datarate);
+        if (!frameBuilt_)
+        {
+            buildFrame();
+        }
+        frameBuilt_ = false;
+        if (LMIC.adrAckReq != LINK_CHECK_OFF)
+        {
+            ++LMIC.adrAckReq;
+        }
+        adrAckRequested_ = LMIC.adrAckReq >= LINK_CHECK_CONT;
+        // The network only accepts uplinks for the session it knows
+        // and with a frame counter higher than the last one accepted.
+        uplinkAccepted_ = LMIC.devaddr == networkDevAddr_ && (int64_t)LMIC.seqnoUp > networkSeqnoUp_;
+        if (uplinkMarginTenfold_ < 0)
+        {
+            uplinkAccepted_ = false;
+            ++simStats.uplinksLost;
+        }
+        else if (uplinkAccepted_)
+        {
+            networkSeqnoUp_ = LMIC.seqnoUp;
+        }
+        else
+        {
+            ++simStats.uplinksRejected;
+        }
+        if (uplinkAccepted_ && simConfig.downlinkEvery != 0 && simStats.uplinks % simConfig.downlinkEvery == 0)
+        {
+            simQueueDownlink(simConfig.downlinkPort, simConfig.downlinkData, simConfig.downlinkLength);
+        }
+        length = frameLength_;
+    }
+
+    // As MCCI LMIC: at EV_TXSTART rps holds the radio parameters
+    // and dataLen the length of the frame that is transmitted.
+    LMIC.rps = updr2rps(LMIC.datarate);
+    LMIC.dataLen = length;
+    reportEvent(EV_TXSTART);
+    LMIC.dataLen = 0;
+
+    uint64_t airtimeUs = simAirtimeUs(LMIC.datarate, length);
+    simStats.airtimeUs += airtimeUs;
+    txAvailableUs_ = nowUs_ + airtimeUs * (DutyCycleFactor + 1);
+    if (!joinTx_)
+    {
+        ++LMIC.seqnoUp;
+    }
+    scheduleRadioJob(nowUs_ + airtimeUs, txEndCb);
+}
+
+static void startTx(void)
+{
+    // As MCCI LMIC: if the data frame can be sent right away it is built 
+    // now, MAC commands added after this call are sent with the next uplink.
+    LMIC.opmode |= OP_TXRXPEND;
+    if (!(LMIC.opmode & OP_JOINING) && txAvailableUs_ <= nowUs_)
+    {
+        buildFrame();
+    }
+    scheduleRadioJob(txAvailableUs_, txStartCb);
+}
+
+
+// -----------------------------------------------------------------------------
+// LMIC API
+
+void LMIC_reset(void)
+{
+    os_clearCallback(&radioJob_);
+    frameBuilt_ = false;
+    memset(&LMIC, 0, sizeof(LMIC));
+    LMIC.datarate = DR_SF7;
+    LMIC.txpow = 16;
+    LMIC.adrTxPow = 16;
+    LMIC.adrEnabled = 1;
+    LMIC.rxDelay = 1;
+    LMIC.dn2Dr = DR_SF12;
+    LMIC.dn2Freq = 869525000;
+    LMIC.adrAckReq = LINK_CHECK_INIT;
+    for (uint8_t channel = 0; channel < DefaultChannels; ++channel)
+    {
+        LMIC_setupChannel(channel, channelFrequencies[channel], DR_RANGE_MAP(DR_SF12, DR_SF7), BAND_CENTI);
+    }
+    LMIC.freq = channelFrequencies[0];
+}
+
+int LMIC_registerEventCb(lmic_event_cb_t* pEventCb, void* pUserData)
+{
+    LMIC.client_eventCb = pEventCb;
+    LMIC.client_eventUserData = pUserData;
+    return 1;
+}
+
+bit_t LMIC_startJoining(void)
+{
+    if (LMIC.devaddr != 0 || (LMIC.opmode & OP_JOINING))
+    {
+        return 0;
+    }
+    LMIC.opmode |= OP_JOINING;
+    LMIC.datarate = DR_SF7;
+    joinTxCount_ = 0;
+    reportEvent(EV_JOINING);
+    txAvailableUs_ = nowUs_ + simRandom(1000000);
+    startTx();
+    return 1;
+}
+
+void LMIC_unjoin(void)
+{
+    os_clearCallback(&radioJob_);
+    frameBuilt_ = false;
+    LMIC.devaddr = 0;
+    LMIC.opmode &= ~(OP_JOINING | OP_TXRXPEND | OP_TXDATA);
+}
+
+void LMIC_unjoinAndRejoin(void)
+{
+    LMIC_unjoin();
+    LMIC_startJoining();
+}
+
+void LMIC_setSession(u4_t netid, devaddr_t devaddr, xref2u1_t nwkKey, xref2u1_t artKey)
+{
+    LMIC.netid = netid;
+    LMIC.devaddr = devaddr;
+    if (nwkKey != nullptr)
+    {
+        memcpy(LMIC.nwkKey, nwkKey, 16);
+    }
+    if (artKey != nullptr)
+    {
+        memcpy(LMIC.artKey, artKey, 16);
+    }
+    LMIC.seqnoUp = 0;
+    LMIC.seqnoDn = 0;
+    LMIC.opmode &= ~(OP_JOINING | OP_LINKDEAD);
+    LMIC.adrAckReq = LINK_CHECK_INIT;
+    if (networkDevAddr_ == 0 && !networkForgotten_)
+    {
+        // ABP: the device is provisioned on the network.
+        networkDevAddr_ = devaddr;
+    }
+}
+
+void LMIC_getSessionKeys(u4_t* netid, devaddr_t* devaddr, xref2u1_t nwkKey, xref2u1_t artKey)
+{
+    *netid = LMIC.netid;
+    *devaddr = LMIC.devaddr;
+    memcpy(nwkKey, LMIC.nwkKey, 16);
+    memcpy(artKey, LMIC.artKey, 16);
+}
+
+bit_t LMIC_setupChannel(u1_t channel, u4_t freq, u2_t drmap, s1_t band)
+{
+    if (channel >= MAX_CHANNELS)
+    {
+        return 0;
+    }
+    LMIC.channelFreq[channel] = (freq & ~(u4_t)3) | (band < 0 ? BAND_CENTI : band);
+    LMIC.channelDrMap[channel] = drmap != 0 ? drmap : DR_RANGE_MAP(DR_SF12, DR_SF7);
+    LMIC.channelMap |= 1 << channel;
+    return 1;
+}
+
+bit_t LMIC_disableChannel(u1_t channel)
+{
+    if (channel >= MAX_CHANNELS)
+    {
+        return 0;
+    }
+    LMIC.channelMap &= ~(1 << channel);
+    return 1;
+}
+
+void LMIC_setAdrMode(bit_t enabled)
+{
+    LMIC.adrEnabled = enabled;
+}
+
+void LMIC_setLinkCheckMode(bit_t enabled)
+{
+    LMIC.adrAckReq = enabled ? LINK_CHECK_INIT : LINK_CHECK_OFF;
+}
+
+void LMIC_setDrTxpow(dr_t dr, s1_t txpow)
+{
+    LMIC.datarate = dr;
+    if (txpow != KEEP_TXPOW)
+    {
+        LMIC.txpow = txpow;
+        LMIC.adrTxPow = txpow;
+    }
+}
+
+void LMIC_setClockError(u2_t error)
+{
+    LMIC.clockError = error;
+}
+
+bit_t LMIC_queryTxReady(void)
+{
+    return (LMIC.opmode & OP_TXDATA) == 0;
+}
+
+void LMIC_clrTxData(void)
+{
+    LMIC.opmode &= ~(OP_TXDATA | OP_POLL);
+    LMIC.pendTxLen = 0;
+}
+
+lmic_tx_error_t LMIC_setTxData2(u1_t port, xref2u1_t data, u1_t dlen, u1_t confirmed)
+{
+    if (dlen > sizeof(LMIC.pendTxData))
+    {
+        return LMIC_ERROR_TX_TOO_LARGE;
+    }
+    if (LMIC.opmode & OP_TXRXPEND)
+    {
+        ++simStats.txBusy;
+        return LMIC_ERROR_TX_BUSY;
+    }
+    if (LMIC.devaddr != 0 && dlen + LMIC.pendMacLen > maxPayloadLength(LMIC.datarate))
+    {
+        ++simStats.txNotFeasible;
+        return LMIC_ERROR_TX_NOT_FEASIBLE;
+    }
+
+    if (data != nullptr)
+    {
+        memcpy(LMIC.pendTxData, data, dlen);
+    }
+    LMIC.pendTxPort = port;
+    LMIC.pendTxConf = confirmed;
+    LMIC.pendTxLen = dlen;
+    LMIC.opmode |= OP_TXDATA;
+
+    if (LMIC.devaddr == 0)
+    {
+        // Not joined: data is sent when the join completes.
+        LMIC_startJoining();
+    }
+    else
+    {
+        startTx();
+    }
+    return LMIC_ERROR_SUCCESS;
+}
+
+void LMIC_sendAlive(void)
+{
+    // Empty frame, sends the pending MAC command responses.
+    if (LMIC.devaddr == 0 || (LMIC.opmode & OP_TXRXPEND))
+    {
+        return;
+    }
+    LMIC.pendTxConf = 0;
+    LMIC.pendTxLen = 0;
+    LMIC.opmode |= OP_POLL;
+    startTx();
+}
+
+
+// -----------------------------------------------------------------------------
+// main
+
+static uint8_t simParseHex(const char* text, uint8_t* data, uint8_t size)
+{
+    // Parses hex bytes (e.g. "C0" or "c1020258"), returns the number of bytes.
+    uint8_t length = 0;
+    unsigned int value;
+    while (length < size && sscanf(text, "%2x", &value) == 1)
+    {
+        data[length++] = (uint8_t)value;
+        text += (text[1] != '\0') ? 2 : 1;
+    }
+    return length;
+}
+
+int main(int argc, char* argv[])
+{
+    int option;
+    while ((option = getopt(argc, argv, "t:qs:j:d:a:r:R:e:A:x:p:v:l:m:n:f:")) != -1)
+    {
+        switch (option)
+        {
+            case 't': simConfig.durationSeconds = strtoul(optarg, nullptr, 0); break;
+            case 'q': simConfig.quiet = true; break;
+            case 's': simConfig.seed = strtoul(optarg, nullptr, 0); break;
+            case 'j': simConfig.failedJoins = strtoul(optarg, nullptr, 0); break;
+            case 'd': simConfig.downlinkEvery = strtoul(optarg, nullptr, 0); break;
+            case 'a': simConfig.ackPercent = (uint8_t)strtoul(optarg, nullptr, 0); break;
+            case 'r': simConfig.joinDataRate = (dr_t)strtoul(optarg, nullptr, 0); break;
+            case 'R': simConfig.resetEvery = strtoul(optarg, nullptr, 0); break;
+            case 'e': simConfig.storageFile = optarg; break;
+            case 'A': simConfig.adrStepEvery = strtoul(optarg, nullptr, 0); break;
+            case 'p': simConfig.downlinkPort = (uint8_t)strtoul(optarg, nullptr, 0); break;
+            case 'v': simConfig.signalVariation = (uint8_t)strtoul(optarg, nullptr, 0); break;
+            case 'l': simConfig.downlinkLossPercent = (uint8_t)strtoul(optarg, nullptr, 0); break;
+            case 'm': simConfig.mobilityPeriod = strtoul(optarg, nullptr, 0); break;
+            case 'f': simConfig.forgetSessionAfter = strtoul(optarg, nullptr, 0); break;
+            case 'n': simConfig.snrTenfold = (int16_t)(strtod(optarg, nullptr) * 10); break;
+            case 'x': simConfig.downlinkLength = simParseHex(optarg, simConfig.downlinkData, 
+                                                             sizeof(simConfig.downlinkData)); break;
+            default:
+                fprintf(stderr, "Usage: %s [-t seconds] [-q] [-s seed] [-j failed-joins] "
+                                "[-d downlink-every] [-a ack-percent] [-r join-datarate] "
+                                "[-R reset-every] [-e storage-file] [-A adr-step-every] "
+                                "[-x downlink-hex] [-p downlink-port] [-v signal-variation] "
+                                "[-l downlink-loss-percent] [-m mobility-period] [-n snr] "
+                                "[-f forget-session-after]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    randomState_ = simConfig.seed != 0 ? simConfig.seed : 1;
+    Serial.setEcho(!simConfig.quiet);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t endUs = (uint64_t)simConfig.durationSeconds * 1000000;
+
+    uint64_t resetUs = (uint64_t)simConfig.resetEvery * 1000000;
+    uint64_t nextResetUs = resetUs;
+    uint64_t forgetUs = (uint64_t)simConfig.forgetSessionAfter * 1000000;
+
+    setup();
+    while (nowUs_ < endUs)
+    {
+        loop();
+        if (forgetUs != 0 && nowUs_ >= forgetUs)
+        {
+            // The network no longer knows the session, the node must join again.
+            networkDevAddr_ = 0;
+            networkSeqnoUp_ = -1;
+            networkForgotten_ = true;
+            forgetUs = 0;
+        }
+        if (resetUs != 0 && nowUs_ >= nextResetUs)
+        {
+            // Simulated reset: the application starts again, the network
+            // (and simulated EEPROM) keep their state.
+            ++simStats.resets;
+            nextResetUs += resetUs;
+            txAvailableUs_ = nowUs_;
+            setup();
+        }
+    }
+
+    double wallUs = std::chrono::duration<double, std::micro>(
+                        std::chrono::steady_clock::now() - wallStart).count();
+    uint32_t uplinks = simStats.uplinks != 0 ? simStats.uplinks : 1;
+
+    Serial.flush();
+    fprintf(stderr, "\n--- LMIC-node native simulation ---\n");
+    fprintf(stderr, "Simulated time:      %lu s\n", (unsigned long)(nowUs_ / 1000000));
+    fprintf(stderr, "Wall time:           %.1f ms\n", wallUs / 1000);
+    fprintf(stderr, "Jobs run:            %llu\n", (unsigned long long)simStats.jobsRun);
+    fprintf(stderr, "Events:              %lu\n", (unsigned long)simStats.events);
+    fprintf(stderr, "Join attempts:       %lu\n", (unsigned long)simStats.joinAttempts);
+    fprintf(stderr, "Uplinks:             %lu (confirmed %lu, acked %lu, rejected %lu, lost %lu)\n",
+            (unsigned long)simStats.uplinks, (unsigned long)simStats.confirmedUplinks,
+            (unsigned long)simStats.acks, (unsigned long)simStats.uplinksRejected, 
+            (unsigned long)simStats.uplinksLost);
+    fprintf(stderr, "Downlinks:           %lu (lost %lu)\n", 
+            (unsigned long)simStats.downlinks, (unsigned long)simStats.downlinksLost);
+    fprintf(stderr, "TX busy / too large: %lu / %lu\n",
+            (unsigned long)simStats.txBusy, (unsigned long)simStats.txNotFeasible);
+    fprintf(stderr, "Airtime:             %.3f s\n", simStats.airtimeUs / 1e6);
+    fprintf(stderr, "RX windows late:     %lu (max %.2f ms)\n",
+            (unsigned long)simStats.rxLate, simStats.rxMaxLateUs / 1e3);
+    fprintf(stderr, "Serial output:       %llu bytes (%.1f ms at %lu bd, %.1f ms blocked)\n",
+            Serial.bytesWritten(), Serial.wireTimeUs() / 1e3, Serial.speed(), Serial.blockedUs() / 1e3);
+    fprintf(stderr, "Display transfers:   %llu bytes (%.1f ms at %lu kHz I2C)\n",
+            (unsigned long long)simDisplayBytes(), simDisplayBytes() * 9 * 1e3 / U8X8::I2cSpeed,
+            (unsigned long)(U8X8::I2cSpeed / 1000));
+    fprintf(stderr, "Idle (awake):        %.1f s, sleeping: %.1f s (%.1f%% of time)\n",
+            simStats.idleUs / 1e6, simStats.sleepUs / 1e6, 
+            100.0 * simStats.sleepUs / (nowUs_ != 0 ? nowUs_ : 1));
+    if (simStats.adrSteps != 0)
+    {
+        fprintf(stderr, "ADR steps:           %lu (data rate now DR%u)\n",
+                (unsigned long)simStats.adrSteps, (unsigned)LMIC.datarate);
+    }
+    if (simStats.linkChecks != 0)
+    {
+        fprintf(stderr, "Link checks:         %lu (data rate now DR%u, TX power %d dBm)\n",
+                (unsigned long)simStats.linkChecks, (unsigned)LMIC.datarate, (int)LMIC.txpow);
+    }
+    if (simStats.linkDead != 0)
+    {
+        fprintf(stderr, "Link dead:           %lu\n", (unsigned long)simStats.linkDead);
+    }
+    if (simStats.resets != 0)
+    {
+        fprintf(stderr, "Resets:              %lu\n", (unsigned long)simStats.resets);
+    }
+    if (EEPROM.commits() != 0)
+    {
+        fprintf(stderr, "Storage:             %lu commits, max %lu writes per byte\n",
+                EEPROM.commits(), EEPROM.maxWritesPerByte());
+    }
+    fprintf(stderr, "Heap allocations:    %llu (%llu bytes)\n",
+            (unsigned long long)simAllocationCount(), (unsigned long long)simAllocatedBytes());
+    fprintf(stderr, "Per uplink:          %.2f us wall, %.1f serial bytes, %.1f display bytes, %.2f allocations\n",
+            wallUs / uplinks, (double)Serial.bytesWritten() / uplinks,
+            (double)simDisplayBytes() / uplinks, (double)simAllocationCount() / uplinks);
+    return 0;
+}
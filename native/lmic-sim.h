@@ -0,0 +1,97 @@
+/*******************************************************************************
+ *
+ *  File:         lmic-sim.h
+ *
+ *  Function:     Control and statistics interface of the LMIC simulator.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  The simulator owns a virtual clock in microseconds.
+ *                os_getTime(), millis() and micros() read it, delay()
+ *                advances it and os_runloop_once() jumps it forward to
+ *                the next scheduled job when nothing is due. A simulated
+ *                day therefore runs in milliseconds of host time.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef LMIC_SIM_H_
+#define LMIC_SIM_H_
+
+#include <stdint.h>
+#include "lmic.h"
+
+struct SimConfig
+{
+    uint32_t durationSeconds = 24UL * 3600;  // Simulated run time
+    bool     quiet = false;                   // Do not echo serial output to stdout
+    uint32_t seed = 1;                        // Seed for the pseudo random generator
+    uint32_t failedJoins = 0;                 // Join attempts without join-accept
+    dr_t     joinDataRate = DR_NONE;          // Data rate after successful join (DR_NONE = join data rate)
+    uint32_t downlinkEvery = 0;               // Downlink for every n-th uplink (0 = none)
+    uint8_t  downlinkPort = 100;
+    uint8_t  downlinkData[MAX_LEN_PAYLOAD] = { 0xC0 };
+    uint8_t  downlinkLength = 1;
+    uint8_t  ackPercent = 100;                // Chance that a confirmed uplink is acked
+    int16_t  rssi = -80;                      // RSSI (dBm) of simulated downlinks
+    int16_t  snrTenfold = 75;                 // SNR (0.1 dB) of simulated downlinks
+    uint8_t  signalVariation = 0;             // Random RSSI variation (+/- dB), SNR varies half as much
+    uint8_t  downlinkLossPercent = 0;         // Chance that a downlink is lost
+    uint32_t mobilityPeriod = 0;              // Node moves away and back in n seconds (0 = stationary)
+    uint32_t resetEvery = 0;                  // Reset the node every n seconds (0 = never)
+    const char* storageFile = nullptr;        // File backing the simulated EEPROM
+    uint32_t adrStepEvery = 0;                // ADR: lower the data rate one step every n uplinks (0 = never)
+    uint32_t forgetSessionAfter = 0;          // Network forgets the session after n seconds (0 = never)
+};
+
+struct SimStats
+{
+    uint32_t events = 0;
+    uint32_t joinAttempts = 0;
+    uint32_t uplinks = 0;
+    uint32_t uplinksRejected = 0;             // Not accepted by the network (unknown session, replay)
+    uint32_t confirmedUplinks = 0;
+    uint32_t acks = 0;
+    uint32_t downlinks = 0;
+    uint32_t txBusy = 0;
+    uint32_t txNotFeasible = 0;
+    uint64_t airtimeUs = 0;
+    uint32_t rxLate = 0;                      // RX windows opened > 1 ms late
+    uint32_t rxMaxLateUs = 0;
+    uint64_t jobsRun = 0;
+    uint32_t resets = 0;
+    uint32_t adrSteps = 0;                    // Data rate lowered by the network (LinkADRReq)
+    uint32_t downlinksLost = 0;
+    uint32_t uplinksLost = 0;                 // Below the demodulation floor of the data rate
+    uint32_t linkChecks = 0;                  // LinkCheckAns sent
+    uint32_t linkDead = 0;                    // EV_LINK_DEAD reported
+    uint64_t idleUs = 0;                      // Awake without a job to run
+    uint64_t sleepUs = 0;                     // Sleeping (USE_SLEEP)
+};
+
+extern SimConfig simConfig;
+extern SimStats simStats;
+
+uint64_t simTimeUs(void);
+void simAdvanceUs(uint64_t us);
+void simSleepUs(uint64_t us);
+void simQueueDownlink(uint8_t fPort, const uint8_t* data, uint8_t length);
+uint64_t simAirtimeUs(dr_t dataRate, uint8_t payloadLength);
+
+// Heap usage, counted by the replaced global operator new.
+uint64_t simAllocationCount(void);
+uint64_t simAllocatedBytes(void);
+
+// Bytes transferred to the (simulated) display, all U8X8 instances.
+uint64_t simDisplayBytes(void);
+
+// Application entry points (LMIC-node.cpp).
+void setup(void);
+void loop(void);
+
+#endif  // LMIC_SIM_H_
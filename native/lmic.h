@@ -0,0 +1,303 @@
+/*******************************************************************************
+ *
+ *  File:         lmic.h
+ *
+ *  Function:     Simulated LMIC library interface for the host-native build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *                Portions Copyright (c) 2014-2016 IBM Corporation,
+ *                Portions Copyright (c) 2016-2021 MCCI Corporation
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Mirrors the subset of the MCCI LoRaWAN LMIC library API
+ *                that LMIC-node uses: types, constants, the LMIC state
+ *                structure, the os_ job scheduler and the LMIC_ functions.
+ *                Names, values and semantics follow the MCCI library so
+ *                LMIC-node.cpp compiles unmodified (MCCI_LMIC code paths).
+ *
+ *                The implementation (lmic-sim.cpp) does not drive a radio.
+ *                It simulates transmissions, RX windows, joins and downlinks
+ *                against a virtual clock. Only region EU868 is simulated.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef LMIC_SIM_LMIC_H_
+#define LMIC_SIM_LMIC_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// LMIC-node detects the MCCI library by this symbol.
+#define _LMIC_CONFIG_PRECONDITIONS_H_
+
+#define ARDUINO_LMIC_VERSION_CALC(major, minor, patch, local) \
+    ((((major) * UINT32_C(1)) << 24) | (((minor) * UINT32_C(1)) << 16) | \
+     (((patch) * UINT32_C(1)) << 8) | ((local) * UINT32_C(1)))
+#define ARDUINO_LMIC_VERSION ARDUINO_LMIC_VERSION_CALC(4, 1, 1, 0)
+
+#if !defined(CFG_eu868)
+    #define CFG_eu868 1
+#endif
+#if !defined(CFG_sx1276_radio) && !defined(CFG_sx1272_radio)
+    #define CFG_sx1276_radio 1
+#endif
+
+typedef uint8_t  bit_t;
+typedef uint8_t  u1_t;
+typedef int8_t   s1_t;
+typedef uint16_t u2_t;
+typedef int16_t  s2_t;
+typedef uint32_t u4_t;
+typedef int32_t  s4_t;
+typedef unsigned int uint;
+typedef const char* str_t;
+typedef u1_t*    xref2u1_t;
+typedef const u1_t* xref2cu1_t;
+
+typedef s4_t     ostime_t;
+typedef u4_t     devaddr_t;
+typedef u1_t     dr_t;
+typedef u2_t     rps_t;
+
+#define LMIC_ABI_STD
+
+// -----------------------------------------------------------------------------
+// Time
+
+#ifndef OSTICKS_PER_SEC
+    #define OSTICKS_PER_SEC 32768
+#endif
+
+#define us2osticks(us)      ((ostime_t)(((int64_t)(us) * OSTICKS_PER_SEC) / 1000000))
+#define ms2osticks(ms)      ((ostime_t)(((int64_t)(ms) * OSTICKS_PER_SEC) / 1000))
+#define sec2osticks(sec)    ((ostime_t)((int64_t)(sec) * OSTICKS_PER_SEC))
+#define osticks2ms(os)      ((s4_t)(((os) * (int64_t)1000) / OSTICKS_PER_SEC))
+#define osticks2us(os)      ((s4_t)(((os) * (int64_t)1000000) / OSTICKS_PER_SEC))
+#define us2osticksCeil(us)  ((ostime_t)(((int64_t)(us) * OSTICKS_PER_SEC + 999999) / 1000000))
+#define us2osticksRound(us) ((ostime_t)(((int64_t)(us) * OSTICKS_PER_SEC + 500000) / 1000000))
+#define ms2osticksCeil(ms)  ((ostime_t)(((int64_t)(ms) * OSTICKS_PER_SEC + 999) / 1000))
+#define ms2osticksRound(ms) ((ostime_t)(((int64_t)(ms) * OSTICKS_PER_SEC + 500) / 1000))
+
+#define MAX_CLOCK_ERROR 65536
+
+// -----------------------------------------------------------------------------
+// Jobs
+
+struct osjob_t;
+typedef void (osjobcb_t)(struct osjob_t*);
+
+struct osjob_t
+{
+    struct osjob_t* next;
+    ostime_t deadline;
+    osjobcb_t* func;
+};
+
+void     os_init(void);
+ostime_t os_getTime(void);
+void     os_setCallback(osjob_t* job, osjobcb_t* cb);
+void     os_setTimedCallback(osjob_t* job, ostime_t time, osjobcb_t* cb);
+void     os_clearCallback(osjob_t* job);
+void     os_runloop_once(void);
+bit_t    os_queryTimeCriticalJobs(ostime_t time);
+
+// -----------------------------------------------------------------------------
+// Events
+
+enum _ev_t { EV_SCAN_TIMEOUT=1, EV_BEACON_FOUND,
+             EV_BEACON_MISSED, EV_BEACON_TRACKED, EV_JOINING,
+             EV_JOINED, EV_RFU1, EV_JOIN_FAILED, EV_REJOIN_FAILED,
+             EV_TXCOMPLETE, EV_LOST_TSYNC, EV_RESET,
+             EV_RXCOMPLETE, EV_LINK_DEAD, EV_LINK_ALIVE, EV_SCAN_FOUND,
+             EV_TXSTART, EV_TXCANCELED, EV_RXSTART, EV_JOIN_TXCOMPLETE };
+typedef enum _ev_t ev_t;
+
+#define LMIC_EVENT_NAME_TABLE__INIT \
+    "<<zero>>", \
+    "EV_SCAN_TIMEOUT", "EV_BEACON_FOUND", \
+    "EV_BEACON_MISSED", "EV_BEACON_TRACKED", "EV_JOINING", \
+    "EV_JOINED", "EV_RFU1", "EV_JOIN_FAILED", "EV_REJOIN_FAILED", \
+    "EV_TXCOMPLETE", "EV_LOST_TSYNC", "EV_RESET", \
+    "EV_RXCOMPLETE", "EV_LINK_DEAD", "EV_LINK_ALIVE", "EV_SCAN_FOUND", \
+    "EV_TXSTART", "EV_TXCANCELED", "EV_RXSTART", "EV_JOIN_TXCOMPLETE"
+
+typedef void LMIC_ABI_STD lmic_event_cb_t(void* pUserData, ev_t e);
+
+// Classic style event handler, called if no callback was registered.
+void onEvent(ev_t ev) __attribute__((weak));
+
+// -----------------------------------------------------------------------------
+// Errors
+
+typedef int lmic_tx_error_t;
+
+enum
+{
+    LMIC_ERROR_SUCCESS = 0,
+    LMIC_ERROR_TX_BUSY = -1,
+    LMIC_ERROR_TX_TOO_LARGE = -2,
+    LMIC_ERROR_TX_NOT_FEASIBLE = -3,
+    LMIC_ERROR_TX_FAILED = -4,
+};
+
+#define LMIC_ERROR_NAME__INIT \
+    "LMIC_ERROR_SUCCESS", \
+    "LMIC_ERROR_TX_BUSY", \
+    "LMIC_ERROR_TX_TOO_LARGE", \
+    "LMIC_ERROR_TX_NOT_FEASIBLE", \
+    "LMIC_ERROR_TX_FAILED"
+
+// -----------------------------------------------------------------------------
+// Radio parameters
+
+enum _cr_t { CR_4_5=0, CR_4_6, CR_4_7, CR_4_8 };
+enum _sf_t { FSK=0, SF7, SF8, SF9, SF10, SF11, SF12, SFrfu };
+enum _bw_t { BW125=0, BW250, BW500, BWrfu };
+typedef u1_t cr_t;
+typedef u1_t sf_t;
+typedef u1_t bw_t;
+
+inline sf_t getSf(rps_t params) { return (sf_t)(params & 0x7); }
+inline bw_t getBw(rps_t params) { return (bw_t)((params >> 3) & 0x3); }
+inline cr_t getCr(rps_t params) { return (cr_t)((params >> 5) & 0x3); }
+inline int  getIh(rps_t params) { return (params >> 8) & 0xFF; }
+inline rps_t makeRps(sf_t sf, bw_t bw, cr_t cr, int ih, int nocrc)
+{
+    return (rps_t)((sf) | ((bw) << 3) | ((cr) << 5) | ((nocrc) ? (1 << 7) : 0) | ((ih & 0xFF) << 8));
+}
+
+// -----------------------------------------------------------------------------
+// Region EU868
+
+enum _dr_eu868_t { DR_SF12=0, DR_SF11, DR_SF10, DR_SF9, DR_SF8, DR_SF7, DR_SF7B, DR_FSK, DR_NONE };
+
+enum { BAND_MILLI=0, BAND_CENTI=1, BAND_DECI=2, BAND_AUX=3 };
+enum { MAX_BANDS = 4 };
+
+inline rps_t updr2rps(dr_t dr)
+{
+    return makeRps(dr == DR_FSK ? FSK : dr <= DR_SF7 ? SF12 - dr : SF7, dr == DR_SF7B ? BW250 : BW125, CR_4_5, 0, 0);
+}
+
+#define DR_RANGE_MAP(drlo,drhi) (((u2_t)0xFFFF<<(drlo)) & ((u2_t)0xFFFF>>(15-(drhi))))
+
+#define CFG_LMIC_EU_like 1
+#define CFG_LMIC_US_like 0
+
+// Data frame layout and MAC commands (lorabase.h)
+enum { OFF_DAT_HDR = 0, OFF_DAT_ADDR = 1, OFF_DAT_FCT = 5, OFF_DAT_SEQNO = 6, OFF_DAT_OPTS = 8 };
+enum { FCT_ADREN = 0x80, FCT_ADRACKReq = 0x40, FCT_ACK = 0x20, FCT_MORE = 0x10, FCT_OPTLEN = 0x0F };
+enum { MCMD_LinkCheckReq = 0x02, MCMD_LinkADRAns = 0x03 };
+enum { MCMD_LinkCheckAns = 0x02, MCMD_LinkADRReq = 0x03 };
+
+// Link check validation (ADRACKReq), uplinks without downlink.
+enum { LINK_CHECK_CONT = 0, LINK_CHECK_DEAD = 32, LINK_CHECK_INIT = -64, LINK_CHECK_OFF = -128 };
+
+enum { MAX_CHANNELS = 16 };
+enum { MAX_LEN_FRAME = 255 };
+enum { MAX_LEN_PAYLOAD = MAX_LEN_FRAME - 13 };
+
+// -----------------------------------------------------------------------------
+// LMIC state
+
+enum { OP_NONE     = 0x0000,
+       OP_SCAN     = 0x0001,
+       OP_TRACK    = 0x0002,
+       OP_JOINING  = 0x0004,
+       OP_TXDATA   = 0x0008,
+       OP_POLL     = 0x0010,
+       OP_REJOIN   = 0x0020,
+       OP_SHUTDOWN = 0x0040,
+       OP_TXRXPEND = 0x0080,
+       OP_RNDTX    = 0x0100,
+       OP_PINGINI  = 0x0200,
+       OP_PINGABLE = 0x0400,
+       OP_NEXTCHNL = 0x0800,
+       OP_LINKDEAD = 0x1000,
+       OP_TESTMODE = 0x2000,
+       OP_UNJOIN   = 0x4000,
+};
+
+enum { TXRX_ACK    = 0x80,
+       TXRX_NACK   = 0x40,
+       TXRX_NOPORT = 0x20,
+       TXRX_PORT   = 0x10,
+       TXRX_DNW1   = 0x01,
+       TXRX_DNW2   = 0x02,
+       TXRX_PING   = 0x04,
+};
+
+struct lmic_t
+{
+    u4_t        freq;
+    rps_t       rps;                          // Radio parameters of the current TX
+    u2_t        opmode;
+    u1_t        txChnl;
+    s1_t        txpow;
+    dr_t        datarate;
+    s1_t        adrTxPow;
+    u1_t        rxDelay;
+    u1_t        rx1DrOffset;
+    s1_t        rssi;
+    s1_t        snr;
+    u1_t        txCnt;
+    u1_t        txrxFlags;
+    u1_t        dataBeg;
+    u1_t        dataLen;
+    u1_t        pendTxPort;
+    u1_t        pendTxConf;
+    u1_t        pendTxLen;
+    u1_t        pendTxData[MAX_LEN_PAYLOAD];
+    u1_t        pendMacLen;                   // MAC command responses pending (bytes)
+    u1_t        pendMacData[16];
+    bit_t       pendMacPiggyback;             // Sent in FOpts of the next uplink
+    bit_t       adrEnabled;
+    s1_t        adrAckReq;                    // LINK_CHECK_OFF or uplinks since last downlink
+    dr_t        dn2Dr;
+    u4_t        dn2Freq;
+    u4_t        channelFreq[MAX_CHANNELS];    // Frequency | band
+    u2_t        channelDrMap[MAX_CHANNELS];
+    u2_t        channelMap;
+    u4_t        netid;
+    devaddr_t   devaddr;
+    u4_t        seqnoUp;
+    u4_t        seqnoDn;
+    ostime_t    txend;
+    u2_t        clockError;
+    u1_t        nwkKey[16];
+    u1_t        artKey[16];
+    u1_t        frame[MAX_LEN_FRAME];
+    lmic_event_cb_t* client_eventCb;
+    void*       client_eventUserData;
+};
+
+extern struct lmic_t LMIC;
+
+// -----------------------------------------------------------------------------
+// LMIC API
+
+void  LMIC_reset(void);
+int   LMIC_registerEventCb(lmic_event_cb_t* pEventCb, void* pUserData);
+bit_t LMIC_startJoining(void);
+void  LMIC_unjoin(void);
+void  LMIC_unjoinAndRejoin(void);
+void  LMIC_setSession(u4_t netid, devaddr_t devaddr, xref2u1_t nwkKey, xref2u1_t artKey);
+void  LMIC_getSessionKeys(u4_t* netid, devaddr_t* devaddr, xref2u1_t nwkKey, xref2u1_t artKey);
+bit_t LMIC_setupChannel(u1_t channel, u4_t freq, u2_t drmap, s1_t band);
+bit_t LMIC_disableChannel(u1_t channel);
+void  LMIC_setAdrMode(bit_t enabled);
+void  LMIC_setLinkCheckMode(bit_t enabled);
+#define KEEP_TXPOW -128
+void  LMIC_setDrTxpow(dr_t dr, s1_t txpow);
+void  LMIC_setClockError(u2_t error);
+bit_t LMIC_queryTxReady(void);
+void  LMIC_clrTxData(void);
+lmic_tx_error_t LMIC_setTxData2(u1_t port, xref2u1_t data, u1_t dlen, u1_t confirmed);
+void  LMIC_sendAlive(void);
+
+#endif  // LMIC_SIM_LMIC_H_
@@ -15,7 +15,50 @@ function decodeUplink(input) {
     var warnings = [];
 
     if (input.fPort == 10) {
-        data.counter = (input.bytes[0] << 8) + input.bytes[1];
+        // Fields defined in src/uplink-schema.h.
+        if (input.bytes.length < schemaPayloadLength) {
+            warnings.push("Payload too short");
+        }
+        data = decodeSchemaPayload(input.bytes);
+    }
+    else if (input.fPort == 11) {
+        // Batch of counter samples (USE_SAMPLE_BATCH): sample interval
+        // in seconds (16 bits) followed by the samples, oldest first.
+        data.interval = readBits(input.bytes, 0, 16, false);
+        var count = Math.floor((input.bytes.length - 2) * 8 / sampleBatchSampleBits);
+        var counters = [];
+        for (var i = 0; i < count; i++) {
+            counters.push(readBits(input.bytes, 16 + i * sampleBatchSampleBits, sampleBatchSampleBits, false));
+        }
+        data.samples = batchSamples(counters, data.interval);
+    }
+    else if (input.fPort == 12) {
+        // Compressed batch of counter samples (SAMPLE_BATCH_COMPRESS): sample
+        // interval in seconds (16 bits) followed by the delta compressed samples.
+        data.interval = readBits(input.bytes, 0, 16, false);
+        data.samples = batchSamples(decodeDeltaSamples(input.bytes, 2), data.interval);
+    }
+    else if (input.fPort == 13) {
+        // Fragment of a message that did not fit in a single uplink (USE_FRAGMENTATION).
+        // Fragments must be combined with reassembleFragments().
+        data.fragment = {
+            fPort: input.bytes[0],
+            messageId: input.bytes[1],
+            index: input.bytes[2] & 0x7F,
+            last: (input.bytes[2] & 0x80) != 0
+        };
+        data.bytes = input.bytes.slice(3);
+    }
+    else if (input.fPort == 14) {
+        // Link quality diagnostics (USE_LINK_QUALITY). RSSI in dBm, SNR in dB,
+        // histograms in percent of downlinks per bin.
+        data = decodeLinkQuality(input.bytes);
+    }
+    else if (input.fPort == 15) {
+        // Join report (USE_JOIN_SCHEDULE), first uplink after joining.
+        data.joinAttempts = readBits(input.bytes, 0, 16, false);
+        data.joinLatency = readBits(input.bytes, 16, 32, false);     // Seconds
+        data.joinDataRate = readBits(input.bytes, 48, 8, false);
     }
     else {
         warnings.push("Unsupported fPort");
@@ -24,4 +67,179 @@ function decodeUplink(input) {
         data: data,
         warnings: warnings
     };
-}
\ No newline at end of file
+}
+
+
+function reassembleFragments(fragments) {
+    // Combines fragments (decoded by decodeUplink() from fPort 13 uplinks,
+    // in any order) into the original messages and decodes these.
+    // Payload formatters are stateless, so this must be called by the 
+    // application (e.g. from a webhook) with the fragments received so far.
+    // Returns the decoded complete messages, incomplete messages are skipped.
+    var messages = {};
+    for (var i = 0; i < fragments.length; i++) {
+        var fragment = fragments[i].fragment;
+        var key = fragment.fPort + ":" + fragment.messageId;
+        var message = messages[key] || (messages[key] = { fPort: fragment.fPort, parts: [], count: 0 });
+        message.parts[fragment.index] = fragments[i].bytes;
+        if (fragment.last) {
+            message.count = fragment.index + 1;
+        }
+    }
+    var result = [];
+    for (var k in messages) {
+        var message = messages[k];
+        var bytes = [];
+        var complete = message.count > 0;
+        for (var j = 0; j < message.count && complete; j++) {
+            complete = message.parts[j] !== undefined;
+            bytes = complete ? bytes.concat(message.parts[j]) : bytes;
+        }
+        if (complete) {
+            result.push(decodeUplink({ fPort: message.fPort, bytes: bytes }));
+        }
+    }
+    return result;
+}
+
+
+function decodeLinkQuality(bytes) {
+    // Decodes the payload written by LinkQualityTracker::encode().
+    var downlinks = readBits(bytes, 80, 16, false);
+    var ackPercent = readBits(bytes, 72, 8, false);
+    var data = {
+        downlinks: downlinks,
+        missedDownlinks: readBits(bytes, 96, 16, false),
+        ackPercent: ackPercent == 255 ? null : ackPercent
+    };
+    if (downlinks > 0) {
+        data.rssi = {
+            average: readBits(bytes, 0, 8, true),
+            min: readBits(bytes, 8, 8, true),
+            max: readBits(bytes, 16, 8, true),
+            histogram: linkQualityHistogram(bytes, 112, -130, 10)
+        };
+        data.snr = {
+            average: readBits(bytes, 24, 16, true) / 10,
+            min: readBits(bytes, 40, 16, true) / 10,
+            max: readBits(bytes, 56, 16, true) / 10,
+            histogram: linkQualityHistogram(bytes, 176, -20, 5)
+        };
+    }
+    return data;
+}
+
+
+function linkQualityHistogram(bytes, bitOffset, firstBin, binWidth) {
+    // Must match LINK_QUALITY_BINS and the bin sizes of the node.
+    var histogram = [];
+    for (var i = 0; i < 8; i++) {
+        histogram.push({
+            from: firstBin + i * binWidth,
+            percent: readBits(bytes, bitOffset + i * 8, 8, false)
+        });
+    }
+    return histogram;
+}
+
+
+// Must match SAMPLE_BATCH_SAMPLE_BITS (8-16) of the node.
+var sampleBatchSampleBits = 16;
+
+
+function readBits(bytes, bitOffset, length, signed) {
+    // Reads a value of length (1-32) bits starting at bitOffset, 
+    // most significant bit first (as written by BitWriter).
+    var value = 0;
+    for (var i = bitOffset; i < bitOffset + length; i++) {
+        value = value * 2 + ((bytes[i >> 3] >> (7 - (i & 7))) & 1);
+    }
+    if (signed && value >= Math.pow(2, length - 1)) {
+        value -= Math.pow(2, length);
+    }
+    return value;
+}
+
+
+function batchSamples(counters, interval) {
+    // Adds the age of each sample: seconds before the last sample in the batch.
+    var samples = [];
+    for (var i = 0; i < counters.length; i++) {
+        samples.push({
+            counter: counters[i],
+            age: (counters.length - 1 - i) * interval
+        });
+    }
+    return samples;
+}
+
+
+function decodeDeltaSamples(bytes, offset) {
+    // Decodes integer samples written by DeltaCompressor, starting at offset:
+    // zigzag encoded varint differences with the previous sample.
+    var samples = [];
+    var previous = 0;
+    var i = offset;
+    while (i < bytes.length) {
+        var value = 0;
+        var scale = 1;
+        var b;
+        do {
+            b = bytes[i++];
+            value += (b & 0x7F) * scale;
+            scale *= 128;
+        } while ((b & 0x80) && i < bytes.length);
+        var delta = (value % 2) ? -(value + 1) / 2 : value / 2;
+        previous = (previous + delta) | 0;
+        samples.push(previous);
+    }
+    return samples;
+}
+
+
+function decodeXorSamples(bytes, offset) {
+    // Decodes floating point samples written by XorCompressor, starting at offset.
+    // Each sample is a control byte (leading zero bytes << 4 | bytes that follow)
+    // and the non zero bytes of the XOR with the bit pattern of the previous sample.
+    var samples = [];
+    var previous = 0;
+    var i = offset;
+    while (i < bytes.length) {
+        var control = bytes[i++];
+        var leading = control >> 4;
+        var meaningful = control & 0x0F;
+        var value = 0;
+        for (var n = 0; n < 4; n++) {
+            value = value * 256 + ((n >= leading && n < leading + meaningful) ? bytes[i++] : 0);
+        }
+        previous = (previous ^ value) >>> 0;
+        samples.push(floatFromBits(previous));
+    }
+    return samples;
+}
+
+
+function floatFromBits(bits) {
+    // Converts a 32-bit IEEE 754 bit pattern to a number.
+    var sign = (bits >>> 31) ? -1 : 1;
+    var exponent = (bits >>> 23) & 0xFF;
+    var mantissa = bits & 0x7FFFFF;
+    if (exponent == 0xFF) {
+        return mantissa ? NaN : sign * Infinity;
+    }
+    if (exponent == 0) {
+        return sign * mantissa * Math.pow(2, -149);
+    }
+    return sign * (1 + mantissa / 8388608) * Math.pow(2, exponent - 127);
+}
+
+
+// >>> Generated by tools/generate-formatter.py from src/uplink-schema.h, do not edit.
+function decodeSchemaPayload(bytes) {
+    // Payload length: 2 bytes (16 bits).
+    return {
+        counter: readBits(bytes, 0, 16, false)
+    };
+}
+var schemaPayloadLength = 2;
+// <<< End of generated code.
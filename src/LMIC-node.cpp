@@ -58,7 +58,11 @@
 //  ▀▀▀ ▀▀▀ ▀▀▀ ▀ ▀   ▀▀▀ ▀▀▀ ▀▀  ▀▀▀   ▀▀  ▀▀▀ ▀▀▀ ▀▀▀ ▀ ▀
 
 
-const uint8_t payloadBufferLength = 4;    // Adjust to fit max payload length
+#ifdef USE_SAMPLE_BATCH
+    const uint8_t payloadBufferLength = SAMPLE_BATCH_PAYLOAD_LENGTH;
+#else
+    const uint8_t payloadBufferLength = uplinkPayloadLength;    // Derived from uplink-schema.h
+#endif
 
 
 //  █ █ █▀▀ █▀▀ █▀▄   █▀▀ █▀█ █▀▄ █▀▀   █▀▀ █▀█ █▀▄
@@ -69,6 +73,9 @@ const uint8_t payloadBufferLength = 4;    // Adjust to fit max payload length
 uint8_t payloadBuffer[payloadBufferLength];
 static osjob_t doWorkJob;
 uint32_t doWorkIntervalSeconds = DO_WORK_INTERVAL_SECONDS;  // Change value in platformio.ini
+ostime_t doWorkNominalTime;      // Fixed rate schedule: time the next doWork run is due (without jitter)
+ostime_t doWorkLastNominalTime;  // Time the last doWork run was due (without jitter)
+bool sessionRestored = false;
 
 // Note: LoRa module pin mappings are defined in the Board Support Files.
 
@@ -161,38 +168,33 @@ void printEvent(ostime_t timestamp,
     #ifdef USE_DISPLAY 
         if (target == PrintTarget::All || target == PrintTarget::Display)
         {
-            display.clearLine(TIME_ROW);
-            display.setCursor(COL_0, TIME_ROW);
-            display.print(F("Time:"));                 
-            display.print(timestamp); 
-            display.clearLine(EVENT_ROW);
+            screen.clearLine(TIME_ROW);
+            screen.setCursor(COL_0, TIME_ROW);
+            screen.print(F("Time:"));                 
+            screen.print(timestamp); 
+            screen.clearLine(EVENT_ROW);
             if (clearDisplayStatusRow)
             {
-                display.clearLine(STATUS_ROW);    
+                screen.clearLine(STATUS_ROW);    
             }
-            display.setCursor(COL_0, EVENT_ROW);               
-            display.print(message);
+            screen.setCursor(COL_0, EVENT_ROW);               
+            screen.print(message);
         }
     #endif  
     
-    #ifdef USE_SERIAL
-        // Create padded/indented output without using printf().
-        // printf() is not default supported/enabled in each Arduino core. 
-        // Not using printf() will save memory for memory constrainted devices.
-        String timeString(timestamp);
-        uint8_t len = timeString.length();
-        uint8_t zerosCount = TIMESTAMP_WIDTH > len ? TIMESTAMP_WIDTH - len : 0;
-
+    #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
         if (target == PrintTarget::All || target == PrintTarget::Serial)
         {
-            printChars(serial, '0', zerosCount);
-            serial.print(timeString);
-            serial.print(":  ");
+            // Create zero-padded output without using printf() or String.
+            char timeString[TIMESTAMP_WIDTH + 1];
+            formatSigned(timeString, timestamp, TIMESTAMP_WIDTH);
+            serialLog.print(timeString);
+            serialLog.print(":  ");
             if (eventLabel)
             {
-                serial.print(F("Event: "));
+                serialLog.print(F("Event: "));
             }
-            serial.println(message);
+            serialLog.println(message);
         }
     #endif   
 }           
@@ -205,31 +207,46 @@ void printEvent(ostime_t timestamp,
     #if defined(USE_DISPLAY) || defined(USE_SERIAL)
         printEvent(timestamp, lmicEventNames[ev], target, clearDisplayStatusRow, true);
     #endif
+
+    #ifdef USE_BINARY_LOG
+        if (target == PrintTarget::All || target == PrintTarget::Serial)
+        {
+            logRecord(timestamp, ev, 0, 0, LMIC.txrxFlags);
+        }
+    #endif
 }
 
 
 void printFrameCounters(PrintTarget target = PrintTarget::All)
 {
+    #if defined(USE_DISPLAY) || defined(USE_SERIAL)
+        char upString[FORMAT_NUMBER_SIZE];
+        char downString[FORMAT_NUMBER_SIZE];
+        formatUnsigned(upString, LMIC.seqnoUp);
+        formatUnsigned(downString, LMIC.seqnoDn);
+    #endif
+
     #ifdef USE_DISPLAY
         if (target == PrintTarget::Display || target == PrintTarget::All)
         {
-            display.clearLine(FRMCNTRS_ROW);
-            display.setCursor(COL_0, FRMCNTRS_ROW);
-            display.print(F("Up:"));
-            display.print(LMIC.seqnoUp);
-            display.print(F(" Dn:"));
-            display.print(LMIC.seqnoDn);        
+            screen.clearLine(FRMCNTRS_ROW);
+            screen.setCursor(COL_0, FRMCNTRS_ROW);
+            screen.print(F("Up:"));
+            screen.print(upString);
+            screen.print(F(" Dn:"));
+            screen.print(downString);        
         }
     #endif
 
-    #ifdef USE_SERIAL
+    #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
+        // Binary log records already contain the frame counters.
         if (target == PrintTarget::Serial || target == PrintTarget::All)
         {
-            printSpaces(serial, MESSAGE_INDENT);
-            serial.print(F("Up: "));
-            serial.print(LMIC.seqnoUp);
-            serial.print(F(",  Down: "));
-            serial.println(LMIC.seqnoDn);        
+            printSpaces(serialLog, MESSAGE_INDENT);
+            serialLog.print(F("Up: "));
+            serialLog.print(upString);
+            serialLog.print(F(",  Down: "));
+            serialLog.println(downString);        
         }
     #endif        
 }      
@@ -237,7 +254,7 @@ void printFrameCounters(PrintTarget target = PrintTarget::All)
 
 void printSessionKeys()
 {    
-    #if defined(USE_SERIAL) && defined(MCCI_LMIC)
+    #if defined(USE_SERIAL) && defined(MCCI_LMIC) && !defined(USE_BINARY_LOG)
         u4_t networkId = 0;
         devaddr_t deviceAddress = 0;
         u1_t networkSessionKey[16];
@@ -245,21 +262,27 @@ void printSessionKeys()
         LMIC_getSessionKeys(&networkId, &deviceAddress, 
                             networkSessionKey, applicationSessionKey);
 
-        printSpaces(serial, MESSAGE_INDENT);    
-        serial.print(F("Network Id: "));
-        serial.println(networkId, DEC);
-
-        printSpaces(serial, MESSAGE_INDENT);    
-        serial.print(F("Device Address: "));
-        serial.println(deviceAddress, HEX);
-
-        printSpaces(serial, MESSAGE_INDENT);    
-        serial.print(F("Application Session Key: "));
-        printHex(serial, applicationSessionKey, 16, true, '-');
-
-        printSpaces(serial, MESSAGE_INDENT);    
-        serial.print(F("Network Session Key:     "));
-        printHex(serial, networkSessionKey, 16, true, '-');
+        char formatted[16 * 3];   // Fits a 16 byte key with separators
+        
+        printSpaces(serialLog, MESSAGE_INDENT);    
+        serialLog.print(F("Network Id: "));
+        formatUnsigned(formatted, networkId);
+        serialLog.println(formatted);
+
+        printSpaces(serialLog, MESSAGE_INDENT);    
+        serialLog.print(F("Device Address: "));
+        formatUnsigned(formatted, deviceAddress, 8, HEX);
+        serialLog.println(formatted);
+
+        printSpaces(serialLog, MESSAGE_INDENT);    
+        serialLog.print(F("Application Session Key: "));
+        formatHex(formatted, applicationSessionKey, 16, '-');
+        serialLog.println(formatted);
+
+        printSpaces(serialLog, MESSAGE_INDENT);    
+        serialLog.print(F("Network Session Key:     "));
+        formatHex(formatted, networkSessionKey, 16, '-');
+        serialLog.println(formatted);
     #endif
 }
 
@@ -269,13 +292,14 @@ void printDownlinkInfo(void)
     #if defined(USE_SERIAL) || defined(USE_DISPLAY)
 
         uint8_t dataLength = LMIC.dataLen;
-        // bool ackReceived = LMIC.txrxFlags & TXRX_ACK;
 
         int16_t snrTenfold = getSnrTenfold();
         int8_t snr = snrTenfold / 10;
-        int8_t snrDecimalFraction = snrTenfold % 10;
         int16_t rssi = getRssi(snr);
 
+        char snrString[FORMAT_NUMBER_SIZE];
+        formatTenfold(snrString, snrTenfold);
+
         uint8_t fPort = 0;        
         if (LMIC.txrxFlags & TXRX_PORT)
         {
@@ -283,50 +307,71 @@ void printDownlinkInfo(void)
         }        
 
         #ifdef USE_DISPLAY
-            display.clearLine(EVENT_ROW);        
-            display.setCursor(COL_0, EVENT_ROW);
-            display.print(F("RX P:"));
-            display.print(fPort);
+            screen.clearLine(EVENT_ROW);        
+            screen.setCursor(COL_0, EVENT_ROW);
+            screen.print(F("RX P:"));
+            screen.print(fPort);
             if (dataLength != 0)
             {
-                display.print(" Len:");
-                display.print(LMIC.dataLen);                       
+                screen.print(" Len:");
+                screen.print(LMIC.dataLen);                       
             }
-            display.clearLine(STATUS_ROW);        
-            display.setCursor(COL_0, STATUS_ROW);
-            display.print(F("RSSI"));
-            display.print(rssi);
-            display.print(F(" SNR"));
-            display.print(snr);                
-            display.print(".");                
-            display.print(snrDecimalFraction);                      
+            screen.clearLine(STATUS_ROW);        
+            screen.setCursor(COL_0, STATUS_ROW);
+            #ifdef USE_LINK_QUALITY
+                // Averages over recent downlinks.
+                char snrAverageString[FORMAT_NUMBER_SIZE];
+                formatTenfold(snrAverageString, linkQuality.snrTenfoldAverage());
+                screen.print(F("RSSI~"));
+                screen.print(linkQuality.rssiAverage());
+                screen.print(F(" SNR~"));
+                screen.print(snrAverageString);
+            #else
+                screen.print(F("RSSI"));
+                screen.print(rssi);
+                screen.print(F(" SNR"));
+                screen.print(snrString);                      
+            #endif
         #endif
 
-        #ifdef USE_SERIAL
-            printSpaces(serial, MESSAGE_INDENT);    
-            serial.println(F("Downlink received"));
-
-            printSpaces(serial, MESSAGE_INDENT);
-            serial.print(F("RSSI: "));
-            serial.print(rssi);
-            serial.print(F(" dBm,  SNR: "));
-            serial.print(snr);                        
-            serial.print(".");                        
-            serial.print(snrDecimalFraction);                        
-            serial.println(F(" dB"));
-
-            printSpaces(serial, MESSAGE_INDENT);    
-            serial.print(F("Port: "));
-            serial.println(fPort);
+        #ifdef USE_BINARY_LOG
+            logRecord(os_getTime(), static_cast<uint8_t>(LogCode::Downlink), 
+                      fPort, dataLength, LMIC.txrxFlags, rssi, snrTenfold);
+        #elif defined(USE_SERIAL)
+            bool ackReceived = LMIC.txrxFlags & TXRX_ACK;
+            printSpaces(serialLog, MESSAGE_INDENT);    
+            serialLog.println(ackReceived ? F("Downlink received (ACK)") : F("Downlink received"));
+
+            printSpaces(serialLog, MESSAGE_INDENT);
+            serialLog.print(F("RSSI: "));
+            serialLog.print(rssi);
+            serialLog.print(F(" dBm,  SNR: "));
+            serialLog.print(snrString);                        
+            serialLog.println(F(" dB"));
+
+            #ifdef USE_LINK_QUALITY
+                formatTenfold(snrString, linkQuality.snrTenfoldAverage());
+                printSpaces(serialLog, MESSAGE_INDENT);
+                serialLog.print(F("Average RSSI: "));
+                serialLog.print(linkQuality.rssiAverage());
+                serialLog.print(F(" dBm,  SNR: "));
+                serialLog.print(snrString);
+                serialLog.print(F(" dB,  missed: "));
+                serialLog.println(linkQuality.missedDownlinks());
+            #endif
+
+            printSpaces(serialLog, MESSAGE_INDENT);    
+            serialLog.print(F("Port: "));
+            serialLog.println(fPort);
    
             if (dataLength != 0)
             {
-                printSpaces(serial, MESSAGE_INDENT);
-                serial.print(F("Length: "));
-                serial.println(LMIC.dataLen);                   
-                printSpaces(serial, MESSAGE_INDENT);    
-                serial.print(F("Data: "));
-                printHex(serial, LMIC.frame+LMIC.dataBeg, LMIC.dataLen, true, ' ');
+                printSpaces(serialLog, MESSAGE_INDENT);
+                serialLog.print(F("Length: "));
+                serialLog.println(LMIC.dataLen);                   
+                printSpaces(serialLog, MESSAGE_INDENT);    
+                serialLog.print(F("Data: "));
+                printHex(serialLog, LMIC.frame+LMIC.dataBeg, LMIC.dataLen, true, ' ');
             }
         #endif
     #endif
@@ -336,48 +381,48 @@ void printDownlinkInfo(void)
 void printHeader(void)
 {
     #ifdef USE_DISPLAY
-        display.clear();
-        display.setCursor(COL_0, HEADER_ROW);
-        display.print(F("LMIC-node"));
+        screen.clear();
+        screen.setCursor(COL_0, HEADER_ROW);
+        screen.print(F("LMIC-node"));
         #ifdef ABP_ACTIVATION
-            display.drawString(ABPMODE_COL, HEADER_ROW, "ABP");
+            screen.drawString(ABPMODE_COL, HEADER_ROW, "ABP");
         #endif
         #ifdef CLASSIC_LMIC
-            display.drawString(CLMICSYMBOL_COL, HEADER_ROW, "*");
+            screen.drawString(CLMICSYMBOL_COL, HEADER_ROW, "*");
         #endif
-        display.drawString(COL_0, DEVICEID_ROW, deviceId);
-        display.setCursor(COL_0, INTERVAL_ROW);
-        display.print(F("Interval:"));
-        display.print(doWorkIntervalSeconds);
-        display.print("s");
+        screen.drawString(COL_0, DEVICEID_ROW, deviceId);
+        screen.setCursor(COL_0, INTERVAL_ROW);
+        screen.print(F("Interval:"));
+        screen.print(doWorkIntervalSeconds);
+        screen.print("s");
     #endif
 
     #ifdef USE_SERIAL
-        serial.println(F("\n\nLMIC-node\n"));
-        serial.print(F("Device-id:     "));
-        serial.println(deviceId);            
-        serial.print(F("LMIC library:  "));
+        serialLog.println(F("\n\nLMIC-node\n"));
+        serialLog.print(F("Device-id:     "));
+        serialLog.println(deviceId);            
+        serialLog.print(F("LMIC library:  "));
         #ifdef MCCI_LMIC  
-            serial.println(F("MCCI"));
+            serialLog.println(F("MCCI"));
         #else
-            serial.println(F("Classic [Deprecated]")); 
+            serialLog.println(F("Classic [Deprecated]")); 
         #endif
-        serial.print(F("Activation:    "));
+        serialLog.print(F("Activation:    "));
         #ifdef OTAA_ACTIVATION  
-            serial.println(F("OTAA"));
+            serialLog.println(F("OTAA"));
         #else
-            serial.println(F("ABP")); 
+            serialLog.println(F("ABP")); 
         #endif
         #if defined(LMIC_DEBUG_LEVEL) && LMIC_DEBUG_LEVEL > 0
-            serial.print(F("LMIC debug:    "));  
-            serial.println(LMIC_DEBUG_LEVEL);
+            serialLog.print(F("LMIC debug:    "));  
+            serialLog.println(LMIC_DEBUG_LEVEL);
         #endif
-        serial.print(F("Interval:      "));
-        serial.print(doWorkIntervalSeconds);
-        serial.println(F(" seconds"));
+        serialLog.print(F("Interval:      "));
+        serialLog.print(doWorkIntervalSeconds);
+        serialLog.println(F(" seconds"));
         if (activationMode == ActivationMode::OTAA)
         {
-            serial.println();
+            serialLog.println();
         }
     #endif
 }     
@@ -430,7 +475,7 @@ void printHeader(void)
             // but only one group of 8 should (a subband) should be active
             // TTN recommends the second sub band, 1 in a zero based count.
             // https://github.com/TheThingsNetwork/gateway-conf/blob/master/US-global_conf.json
-            LMIC_selectSubBand(1);
+            LMIC_selectSubBand(SUBBAND);
         #elif defined(CFG_as923)
             // Set up the channels used in your country. Only two are defined by default,
             // and they cannot be changed.  Use BAND_CENTI to indicate 1% duty cycle.
@@ -497,7 +542,12 @@ void initLmic(bit_t adrEnabled = 1,
             // but only one group of 8 should (a subband) should be active
             // TTN recommends the second sub band, 1 in a zero based count.
             // https://github.com/TheThingsNetwork/gateway-conf/blob/master/US-global_conf.json
-            LMIC_selectSubBand(1); 
+            #ifdef USE_SUBBAND_DISCOVERY
+                // Sub-band of the last successful join, if stored.
+                LMIC_selectSubBand(subBandSelector.subBand());
+            #else
+                LMIC_selectSubBand(SUBBAND); 
+            #endif
         #endif
     }
 
@@ -514,11 +564,11 @@ void initLmic(bit_t adrEnabled = 1,
         #endif
 
         #ifdef USE_SERIAL
-            serial.print(F("Clock Error:   "));
-            serial.print(LMIC_CLOCK_ERROR_PPM);
-            serial.print(" ppm (");
-            serial.print(clockError);
-            serial.println(")");            
+            serialLog.print(F("Clock Error:   "));
+            serialLog.print(LMIC_CLOCK_ERROR_PPM);
+            serialLog.print(" ppm (");
+            serialLog.print(clockError);
+            serialLog.println(")");            
         #endif
     #endif
 
@@ -527,7 +577,92 @@ void initLmic(bit_t adrEnabled = 1,
         // additional features (e.g. make EV_RXSTART available). User data pointer is omitted.
         LMIC_registerEventCb(&onLmicEvent, nullptr);
     #endif
+
+    #ifdef USE_SESSION_STORE
+        // Continue the stored session (if any) instead of joining again.
+        sessionRestored = restoreSession();
+        if (sessionRestored)
+        {
+            // Unlike after EV_JOINED, link check validation stays enabled: 
+            // when the network does not answer the ADRACKReq of the following 
+            // uplinks (e.g. because it no longer knows the restored session) 
+            // LMIC reports EV_LINK_DEAD and the node joins again.
+            LMIC_setLinkCheckMode(1);
+            printEvent(os_getTime(), "Session restored");
+            printFrameCounters();
+            #ifdef USE_BINARY_LOG
+                logRecord(os_getTime(), LogCode::SessionRestored);
+            #endif
+        }
+    #endif
+}
+
+
+#ifdef USE_AIRTIME
+void recordAirtime(ostime_t timestamp)
+{
+    // Adds the time-on-air of the transmission that has just started.
+    // At EV_TXSTART LMIC.rps holds the radio parameters
+    // and LMIC.dataLen the length of the frame.
+    uint8_t band = 0;
+    #if CFG_LMIC_EU_like
+        band = LMIC.channelFreq[LMIC.txChnl] & 0x3;
+    #endif
+    uint32_t airtimeUs = timeOnAirUs(LMIC.rps, LMIC.dataLen);
+    airtime.add(band, airtimeUs);
+    #ifdef USE_AIRTIME_GOVERNOR
+        if (!(LMIC.opmode & OP_JOINING))
+        {
+            airtimeGovernor.uplinkStarted(LMIC.dataLen);
+        }
+    #endif
+    uint32_t last24HoursMs = airtime.last24HoursMs();
+
+    #ifdef USE_BINARY_LOG
+        logRecord(timestamp, static_cast<uint8_t>(LogCode::Airtime), 0, band, 0,
+                  airtimeUs / 1000, last24HoursMs / 1000 < 0x7FFF ? last24HoursMs / 1000 : 0x7FFF);
+    #elif defined(USE_SERIAL)
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("Airtime: "));
+        serialLog.print(airtimeUs / 1000);
+        serialLog.print(F(" ms,  24h: "));
+        serialLog.print(last24HoursMs);
+        serialLog.print(F(" ms,  Band "));
+        serialLog.print(band);
+        serialLog.print(F(" 1h: "));
+        serialLog.print(airtime.bandLastHourMs(band));
+        serialLog.println(F(" ms"));
+    #endif
+    #ifdef USE_DISPLAY
+        screen.clearLine(AIRTIME_ROW);
+        screen.setCursor(COL_0, AIRTIME_ROW);
+        screen.print(F("Air 24h:"));
+        screen.print(last24HoursMs / 1000);
+        screen.print(".");
+        screen.print((last24HoursMs / 100) % 10);
+        screen.print("s");
+    #endif
+}
+#endif
+
+
+#if defined(USE_SESSION_STORE) && defined(OTAA_ACTIVATION)
+static osjob_t rejoinJob;
+
+static void rejoinCallback(osjob_t* job)
+{
+    // Discards the stored session and joins again. Scheduled on EV_LINK_DEAD,
+    // runs after LMIC has reported EV_TXCOMPLETE (which stores the session).
+    clearSession();
+    sessionRestored = false;
+    #ifdef USE_JOIN_SCHEDULE
+        LMIC_unjoin();
+        startJoinSchedule();
+    #else
+        LMIC_unjoinAndRejoin();
+    #endif
 }
+#endif
 
 
 #ifdef MCCI_LMIC 
@@ -544,15 +679,33 @@ void onEvent(ev_t ev)
 #ifdef MCCI_LMIC
         // Only supported in MCCI LMIC library:
         case EV_RXSTART:
-            // Do not print anything for this event or it will mess up timing.
+            #ifdef USE_SERIAL_LOG_BUFFER
+                // Buffered serial output does not block and will not disturb timing.
+                printEvent(timestamp, ev, PrintTarget::Serial);
+            #endif
+            // Otherwise do not print anything for this event or it will mess up timing.
             break;
 
         case EV_TXSTART:
             setTxIndicatorsOn();
             printEvent(timestamp, ev);            
+            #ifdef USE_AIRTIME
+                recordAirtime(timestamp);
+            #endif
             break;               
 
         case EV_JOIN_TXCOMPLETE:
+            setTxIndicatorsOn(false);
+            printEvent(timestamp, ev);
+            #ifdef USE_SUBBAND_DISCOVERY
+                processSubBandJoinFailed(timestamp);
+            #endif
+            #ifdef USE_JOIN_SCHEDULE
+                // No join-accept, the join schedule decides when to try again.
+                scheduleNextJoin(timestamp);
+            #endif
+            break;               
+
         case EV_TXCANCELED:
             setTxIndicatorsOn(false);
             printEvent(timestamp, ev);
@@ -569,13 +722,29 @@ void onEvent(ev_t ev)
             // max TX size, it is not used in this example.                    
             LMIC_setLinkCheckMode(0);
 
+            #ifdef USE_SESSION_STORE
+                storeSession(true);
+            #endif
+            #ifdef USE_SUBBAND_DISCOVERY
+                processSubBandJoined(timestamp);
+            #endif
+
             // The doWork job has probably run already (while
             // the node was still joining) and have rescheduled itself.
             // Cancel the next scheduled doWork job and re-schedule
             // for immediate execution to prevent that any uplink will
             // have to wait until the current doWork interval ends.
-            os_clearCallback(&doWorkJob);
-            os_setCallback(&doWorkJob, doWorkCallback);
+            // The fixed rate schedule starts again from here.
+            #ifdef USE_JOIN_SCHEDULE
+                // The join report is sent first, doWork starts when it has been
+                // sent (or one interval later if it could not be scheduled).
+                if (processJoined(timestamp))
+                {
+                    startDoWorkSchedule(os_getTime() + sec2osticks((int64_t)doWorkIntervalSeconds));
+                    break;
+                }
+            #endif
+            startDoWorkSchedule(os_getTime());
             break;
 
         case EV_TXCOMPLETE:
@@ -584,6 +753,15 @@ void onEvent(ev_t ev)
             printEvent(timestamp, ev);
             printFrameCounters();
 
+            #ifdef USE_SESSION_STORE
+                // Store changed session parameters and (periodically) frame counters.
+                storeSession();
+            #endif
+
+            #ifdef USE_LINK_QUALITY
+                updateLinkQuality();
+            #endif
+
             // Check if downlink was received
             if (LMIC.dataLen != 0 || LMIC.dataBeg != 0)
             {
@@ -595,6 +773,33 @@ void onEvent(ev_t ev)
                 printDownlinkInfo();
                 processDownlink(timestamp, fPort, LMIC.frame + LMIC.dataBeg, LMIC.dataLen);                
             }
+
+            #ifdef USE_JOIN_SCHEDULE
+                if (joinScheduler.reportPending() && LMIC.pendTxPort == JOIN_REPORT_FPORT)
+                {
+                    // The join report has been sent, start doWork.
+                    joinScheduler.reportSent();
+                    startDoWorkSchedule(os_getTime());
+                }
+            #endif
+            #ifdef USE_MOBILE_DATA_RATE
+                processLinkCheck(timestamp);
+            #endif
+            #ifdef USE_CONFIRM_POLICY
+                processAck(timestamp);
+            #endif
+            #ifdef USE_FRAGMENTATION
+                // Send the next fragment (if any), before queued messages.
+                sendNextFragment();
+            #endif
+            #ifdef USE_UPLINK_QUEUE
+                // Send the next queued message (if any).
+                sendQueuedUplink();
+            #endif
+            #ifdef USE_LINK_QUALITY
+                // Send the diagnostics uplink when due and nothing else is pending.
+                sendLinkQualityUplink();
+            #endif
             break;     
           
         // Below events are printed only.
@@ -609,7 +814,6 @@ void onEvent(ev_t ev)
         case EV_LOST_TSYNC:
         case EV_RESET:
         case EV_RXCOMPLETE:
-        case EV_LINK_DEAD:
         case EV_LINK_ALIVE:
 #ifdef MCCI_LMIC
         // Only supported in MCCI LMIC library:
@@ -618,21 +822,157 @@ void onEvent(ev_t ev)
             printEvent(timestamp, ev);    
             break;
 
+        case EV_LINK_DEAD:
+            printEvent(timestamp, ev);
+            #if defined(USE_SESSION_STORE) && defined(OTAA_ACTIVATION)
+                // The network no longer responds, the (restored) session
+                // may no longer be valid: discard it and join again.
+                os_setCallback(&rejoinJob, rejoinCallback);
+            #endif
+            break;
+
         default: 
             printEvent(timestamp, "Unknown Event");    
+            #ifdef USE_BINARY_LOG
+                logRecord(timestamp, ev);
+            #endif
             break;
     }
 }
 
 
+static uint32_t xorshift32(uint32_t state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+
+static uint32_t deviceSeed()
+{
+    // Seed derived from the DevEUI (OTAA) or DevAddr (ABP), so nodes
+    // that start at the same time get different random numbers, also
+    // when their random number generators start the same. Never 0.
+    #ifdef OTAA_ACTIVATION
+        uint8_t devEui[8];
+        os_getDevEui(devEui);
+        uint32_t seed = crc16(devEui, 4) | (uint32_t)crc16(devEui + 4, 4) << 16;
+    #else
+        uint32_t seed = DEVADDR;
+    #endif
+    return seed != 0 ? seed : 1;
+}
+
+
+uint32_t doWorkJitterRandom()
+{
+    // Pseudo random numbers (xorshift32), seeded with deviceSeed().
+    static uint32_t state = 0;
+    if (state == 0)
+    {
+        state = deviceSeed();
+    }
+    state = xorshift32(state);
+    return state;
+}
+
+
+static uint32_t doWorkJitterTicks()
+{
+    // DO_WORK_JITTER_SECONDS (max the interval) in ticks.
+    uint32_t window = DO_WORK_JITTER_SECONDS < doWorkIntervalSeconds ? DO_WORK_JITTER_SECONDS : doWorkIntervalSeconds;
+    return (uint32_t)sec2osticks((int64_t)window);
+}
+
+
+void startDoWorkSchedule(ostime_t startTime)
+{
+    // Starts the fixed rate doWork schedule (at boot and when joined) at 
+    // startTime plus a fixed per device phase offset of 0 up to 
+    // DO_WORK_JITTER_SECONDS (max the interval). The offset is derived from
+    // deviceSeed(), so nodes that start together (e.g. after a power failure)
+    // stay out of phase, and a node keeps the same phase after every restart.
+    ostime_t phase = 0;
+    if (DO_WORK_JITTER_SECONDS != 0)
+    {
+        phase = xorshift32(deviceSeed()) % doWorkJitterTicks();
+    }
+    scheduleDoWork(startTime + phase);
+}
+
+
+void scheduleDoWork(ostime_t nominalTime, bool jitter)
+{
+    // Schedules the doWork job for nominalTime, plus a small random jitter
+    // centred on zero (+/- 1/16 of DO_WORK_JITTER_SECONDS, max the interval)
+    // if jitter is true. The jitter does not shift the schedule: each run is
+    // due one interval after the previous was due, so the long-run rate is
+    // exact. A timed callback is used so doWorkJob.deadline always holds 
+    // the time of the next run.
+    doWorkLastNominalTime = doWorkNominalTime;
+    doWorkNominalTime = nominalTime;
+    ostime_t startAt = nominalTime;
+    if (jitter && DO_WORK_JITTER_SECONDS != 0)
+    {
+        // Odd range, so the jitter is symmetric around zero.
+        uint32_t range = (doWorkJitterTicks() / 8) | 1;
+        startAt += (ostime_t)(doWorkJitterRandom() % range) - (ostime_t)(range / 2);
+    }
+    os_clearCallback(&doWorkJob);
+    os_setTimedCallback(&doWorkJob, startAt, doWorkCallback);
+}
+
+
+#ifdef USE_AIRTIME_GOVERNOR
+    uint32_t governedIntervalSeconds = 0;     // Interval of the last doWork reschedule, 0 if not yet known
+#endif
+
+uint32_t governedDoWorkInterval(ostime_t timestamp)
+{
+    // Returns the interval until the next doWork run: doWorkIntervalSeconds,
+    // or longer if needed to stay within the daily airtime budget (USE_AIRTIME_GOVERNOR).
+    // With USE_SAMPLE_BATCH uplinks are held back (see processWork()) and
+    // the samples are batched. Sampling is only slowed down as far as needed
+    // to fit all samples collected in between uplinks in the batch.
+
+    uint32_t intervalSeconds = doWorkIntervalSeconds;
+    #ifdef USE_AIRTIME_GOVERNOR
+        uint32_t uplinkSeconds = airtimeGovernor.uplinkIntervalSeconds();
+        #ifdef USE_SAMPLE_BATCH
+            uplinkSeconds = (uplinkSeconds + SAMPLE_BATCH_SIZE - 1) / SAMPLE_BATCH_SIZE;
+        #endif
+        if (uplinkSeconds > intervalSeconds)
+        {
+            intervalSeconds = uplinkSeconds;
+        }
+        if (intervalSeconds != governedIntervalSeconds && governedIntervalSeconds != 0)
+        {
+            #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
+                printEvent(timestamp, "Interval adjusted for airtime budget", PrintTarget::Serial);
+                printSpaces(serialLog, MESSAGE_INDENT);
+                serialLog.print(F("Interval: "));
+                serialLog.print(intervalSeconds);
+                serialLog.println(F(" seconds"));
+            #endif
+        }
+        governedIntervalSeconds = intervalSeconds;
+    #endif
+    return intervalSeconds;
+}
+
+
 static void doWorkCallback(osjob_t* job)
 {
     // Event hander for doWorkJob. Gets called by the LMIC scheduler.
     // The actual work is performed in function processWork() which is called below.
 
     ostime_t timestamp = os_getTime();
-    #ifdef USE_SERIAL
-        serial.println();
+    #ifdef USE_BINARY_LOG
+        logRecord(timestamp, LogCode::DoWorkStarted);
+    #elif defined(USE_SERIAL)
+        serialLog.println();
         printEvent(timestamp, "doWork job started", PrintTarget::Serial);
     #endif    
 
@@ -640,21 +980,147 @@ static void doWorkCallback(osjob_t* job)
     processWork(timestamp);
 
     // This job must explicitly reschedule itself for the next run.
-    ostime_t startAt = timestamp + sec2osticks((int64_t)doWorkIntervalSeconds);
-    os_setTimedCallback(&doWorkJob, startAt, doWorkCallback);    
+    // Fixed rate: the next run is due one interval after this run was due,
+    // not after it actually ran, so processing time and LMIC latency
+    // do not accumulate as drift. If this run was more than an interval
+    // late, the runs that were missed are skipped and the schedule 
+    // stays in phase.
+    ostime_t interval = sec2osticks((int64_t)governedDoWorkInterval(timestamp));
+    ostime_t nominalTime = doWorkNominalTime + interval;
+    ostime_t now = os_getTime();
+    if (nominalTime - now <= 0)
+    {
+        nominalTime += ((now - nominalTime) / interval + 1) * interval;
+    }
+    scheduleDoWork(nominalTime, true);
+}
+
+
+bool setDoWorkInterval(uint32_t seconds)
+{
+    // Changes the doWork interval at runtime (e.g. from a downlink command).
+    // The next doWork job is rescheduled immediately: at the time the last
+    // run plus the new interval, or right away if that time has already passed.
+    // The new interval is saved to storage (if available) and is used again
+    // after a restart.
+
+    ostime_t timestamp = os_getTime();
+    // ostime_t overflows for intervals of 2^31 ticks or longer
+    // (65535 seconds at the default OSTICKS_PER_SEC of 32768).
+    if (seconds == 0 || seconds > 0x7FFFFFFF / OSTICKS_PER_SEC)
+    {
+        #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
+            printEvent(timestamp, "Invalid interval", PrintTarget::Serial);
+        #endif
+        return false;
+    }
+
+    ostime_t startAt = doWorkLastNominalTime + sec2osticks((int64_t)seconds);
+    bool jitter = true;
+    if (startAt - timestamp < 0)
+    {
+        startAt = timestamp;
+        jitter = false;
+    }
+    doWorkIntervalSeconds = seconds;
+    doWorkNominalTime = doWorkLastNominalTime;
+    scheduleDoWork(startAt, jitter);
+
+    #ifdef STORAGE_SIZE
+        SettingsRecord settings;
+        loadSettings(settings);
+        settings.doWorkIntervalSeconds = seconds;
+        storeSettings(settings);
+    #endif
+
+    #ifdef USE_BINARY_LOG
+        logRecord(timestamp, LogCode::IntervalChanged);
+    #elif defined(USE_SERIAL)
+        printEvent(timestamp, "Interval changed", PrintTarget::Serial);
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("Interval: "));
+        serialLog.print(seconds);
+        serialLog.println(F(" seconds"));
+    #endif
+    #ifdef USE_DISPLAY
+        // The interval row (interval and counter) is refreshed by the next processWork().
+        printEvent(timestamp, "Interval changed", PrintTarget::Display);
+    #endif
+    return true;
 }
 
 
+#ifdef USE_CONFIRM_POLICY
+    static osjob_t confirmRetryJob;         // Retry of an unacknowledged uplink
+#endif
+
+
 lmic_tx_error_t scheduleUplink(uint8_t fPort, uint8_t* data, uint8_t dataLength, bool confirmed = false)
 {
     // This function is called from the processWork() function to schedule
     // transmission of an uplink message that was prepared by processWork().
     // Transmission will be performed at the next possible time
+    // A message that is too large for the current data rate is sent in
+    // fragments (USE_FRAGMENTATION), or is not scheduled (LMIC_ERROR_TX_NOT_FEASIBLE).
 
-    ostime_t timestamp = os_getTime();
-    printEvent(timestamp, "Packet queued");
+    #ifdef USE_FRAGMENTATION
+        if (LMIC.devaddr != 0 && dataLength > maxUplinkPayloadLength() && !uplinkFragmenter.owns(data)
+            && uplinkFragmenter.start(fPort, data, dataLength, confirmed, LMIC.seqnoUp & 0xFF))
+        {
+            sendNextFragment();
+            return LMIC_ERROR_SUCCESS;
+        }
+    #endif
 
-    lmic_tx_error_t retval = LMIC_setTxData2(fPort, data, dataLength, confirmed ? 1 : 0);
+    #ifdef USE_CONFIRM_POLICY
+        // Critical fPorts and every CONFIRM_EVERY uplink are sent confirmed.
+        confirmed = confirmPolicy.confirm(fPort, confirmed);
+    #endif
+
+    ostime_t timestamp;
+    lmic_tx_error_t retval;
+    if (LMIC.devaddr != 0 && dataLength > maxUplinkPayloadLength())
+    {
+        // Would not fit in a frame at the current data rate.
+        retval = LMIC_ERROR_TX_NOT_FEASIBLE;
+    }
+    #ifdef USE_FRAGMENTATION
+    else if (uplinkFragmenter.pending() && !uplinkFragmenter.owns(data))
+    {
+        // Do not replace a fragment that has not been sent yet.
+        retval = LMIC_ERROR_TX_BUSY;
+    }
+    #endif
+    else
+    {
+        // Printed before LMIC_setTxData2(), which can start the transmission
+        // (EV_TXSTART) right away.
+        timestamp = os_getTime();
+        printEvent(timestamp, "Packet queued");
+        #ifdef USE_BINARY_LOG
+            logRecord(timestamp, LogCode::UplinkQueued, fPort, dataLength);
+        #endif
+        #ifdef USE_MOBILE_DATA_RATE
+            // The LinkCheckReq is added before LMIC_setTxData2(): MCCI LMIC
+            // builds the frame right away if the radio and channel are free.
+            uint8_t pendMacLen = LMIC.pendMacLen;
+            bit_t pendMacPiggyback = LMIC.pendMacPiggyback;
+            bool linkCheck = dataRateController.linkCheckDue() && requestLinkCheck(dataLength);
+        #endif
+        retval = LMIC_setTxData2(fPort, data, dataLength, confirmed ? 1 : 0);
+        #ifdef USE_MOBILE_DATA_RATE
+            if (linkCheck && retval == LMIC_ERROR_SUCCESS)
+            {
+                dataRateController.linkCheckSent();
+            }
+            else if (linkCheck)
+            {
+                // Not sent, remove the request again.
+                LMIC.pendMacLen = pendMacLen;
+                LMIC.pendMacPiggyback = pendMacPiggyback;
+            }
+        #endif
+    }
     timestamp = os_getTime();
 
     if (retval == LMIC_ERROR_SUCCESS)
@@ -663,29 +1129,603 @@ lmic_tx_error_t scheduleUplink(uint8_t fPort, uint8_t* data, uint8_t dataLength,
             // For MCCI_LMIC this will be handled in EV_TXSTART        
             setTxIndicatorsOn();  
         #endif        
+        #ifdef USE_CONFIRM_POLICY
+            if (confirmed)
+            {
+                if (data != confirmPolicy.data())
+                {
+                    // New data replaces an uplink that is waiting for a retry.
+                    os_clearCallback(&confirmRetryJob);
+                }
+                confirmPolicy.sent(fPort, data, dataLength);
+            }
+        #endif
     }
     else
     {
-        String errmsg; 
-        #ifdef USE_SERIAL
-            errmsg = "LMIC Error: ";
+        #ifdef USE_BINARY_LOG
+            logRecord(timestamp, LogCode::UplinkError, fPort, dataLength, (uint8_t)(-retval));
+        #elif defined(USE_SERIAL)
+            // Fixed size buffer, fits longest error name.
+            char errmsg[48];
+            strcpy(errmsg, "LMIC Error: ");
             #ifdef MCCI_LMIC
-                errmsg.concat(lmicErrorNames[abs(retval)]);
+                strncat(errmsg, lmicErrorNames[abs(retval)], sizeof(errmsg) - strlen(errmsg) - 1);
             #else
-                errmsg.concat(retval);
+                formatSigned(errmsg + strlen(errmsg), retval);
             #endif
-            printEvent(timestamp, errmsg.c_str(), PrintTarget::Serial);
+            printEvent(timestamp, errmsg, PrintTarget::Serial);
         #endif
         #ifdef USE_DISPLAY
-            errmsg = "LMIC Err: ";
-            errmsg.concat(retval);
-            printEvent(timestamp, errmsg.c_str(), PrintTarget::Display);
+            char displayMsg[24];
+            strcpy(displayMsg, "LMIC Err: ");
+            formatSigned(displayMsg + strlen(displayMsg), retval);
+            printEvent(timestamp, displayMsg, PrintTarget::Display);
         #endif         
     }
     return retval;    
 }
 
 
+#ifdef USE_CONFIRM_POLICY
+static void confirmRetryCallback(osjob_t* job)
+{
+    // Sends an unacknowledged confirmed uplink again.
+    if (!confirmPolicy.pending())
+    {
+        return;     // Acknowledged or replaced by new data in the meantime
+    }
+    if (LMIC.opmode & (OP_JOINING | OP_TXDATA | OP_TXRXPEND))
+    {
+        // Busy with another uplink, try again later.
+        os_setTimedCallback(&confirmRetryJob, os_getTime() + sec2osticks(CONFIRM_RETRY_BACKOFF_SECONDS), 
+                            confirmRetryCallback);
+        return;
+    }
+    if (scheduleUplink(confirmPolicy.fPort(), confirmPolicy.data(), confirmPolicy.length(), true) != LMIC_ERROR_SUCCESS)
+    {
+        // Not sent (error reported by scheduleUplink()). Counts as a retry, 
+        // so the uplink is given up (no longer pending) when retries run out.
+        uint32_t delaySeconds = 0;
+        if (confirmPolicy.retry(delaySeconds))
+        {
+            os_setTimedCallback(&confirmRetryJob, os_getTime() + sec2osticks((int64_t)delaySeconds), 
+                                confirmRetryCallback);
+        }
+    }
+}
+
+
+void processAck(ostime_t timestamp)
+{
+    // Called on EV_TXCOMPLETE. Keeps track of ACKs for confirmed uplinks
+    // and schedules a retry for an uplink that was not acknowledged.
+    if (LMIC.txrxFlags & TXRX_ACK)
+    {
+        confirmPolicy.result(true);
+        os_clearCallback(&confirmRetryJob);
+        return;
+    }
+    if (!(LMIC.txrxFlags & TXRX_NACK))
+    {
+        return;     // Not a confirmed uplink
+    }
+    confirmPolicy.result(false);
+    uint32_t delaySeconds = 0;
+    bool retry = confirmPolicy.retry(delaySeconds);
+    if (retry)
+    {
+        os_setTimedCallback(&confirmRetryJob, timestamp + sec2osticks((int64_t)delaySeconds), confirmRetryCallback);
+    }
+    #ifdef USE_BINARY_LOG
+        logRecord(timestamp, LogCode::NotAcknowledged, 0, confirmPolicy.ackPercent(), 
+                  retry ? confirmPolicy.retries() : 0);
+    #elif defined(USE_SERIAL)
+        printEvent(timestamp, "Uplink not acknowledged", PrintTarget::Serial);
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("ACK success: "));
+        serialLog.print(confirmPolicy.ackPercent());
+        serialLog.print(F("%"));
+        if (retry)
+        {
+            serialLog.print(F(",  retry "));
+            serialLog.print(confirmPolicy.retries());
+            serialLog.print(F(" in "));
+            serialLog.print(delaySeconds);
+            serialLog.print(F(" s"));
+        }
+        serialLog.println();
+    #endif
+    #ifdef USE_DISPLAY
+        printEvent(timestamp, "No ACK", PrintTarget::Display, false);
+    #endif
+}
+#endif
+
+
+#ifdef USE_MOBILE_DATA_RATE
+bool requestLinkCheck(uint8_t dataLength)
+{
+    // Adds a LinkCheckReq to the MAC commands that LMIC sends in the 
+    // frame header (FOpts) of the next uplink. Must be called before
+    // LMIC_setTxData2(), which may build the frame right away.
+    // Returns false if there is no room for it or the node has not joined.
+    if (LMIC.devaddr == 0 || LMIC.pendMacLen >= 15 || (LMIC.pendMacLen != 0 && !LMIC.pendMacPiggyback)
+        || dataLength >= maxUplinkPayloadLength())
+    {
+        return false;
+    }
+    LMIC.pendMacData[LMIC.pendMacLen++] = MCMD_LinkCheckReq;
+    LMIC.pendMacPiggyback = 1;
+    return true;
+}
+
+
+bool readLinkCheckAns(uint8_t& margin, uint8_t& gatewayCount)
+{
+    // Finds a LinkCheckAns in the MAC commands of the received downlink:
+    // in the frame header (FOpts) or, without FOpts, in an fPort 0 payload.
+    // LMIC processes the MAC commands but does not keep the answer.
+    static const uint8_t macCommandLength[] = {
+        // Length of downlink MAC commands 0x02 - 0x0A, including the command.
+        3, 5, 2, 5, 1, 6, 2, 2, 5 
+    };
+    if (!(LMIC.txrxFlags & (TXRX_DNW1 | TXRX_DNW2)))
+    {
+        return false;
+    }
+    const uint8_t* commands = LMIC.frame + OFF_DAT_OPTS;
+    uint8_t length = LMIC.frame[OFF_DAT_FCT] & FCT_OPTLEN;
+    if (length == 0 && (LMIC.txrxFlags & TXRX_PORT) && LMIC.frame[LMIC.dataBeg - 1] == 0)
+    {
+        commands = LMIC.frame + LMIC.dataBeg;
+        length = LMIC.dataLen;
+    }
+    uint8_t i = 0;
+    while (i < length)
+    {
+        uint8_t command = commands[i];
+        if (command < MCMD_LinkCheckAns || command >= MCMD_LinkCheckAns + sizeof(macCommandLength))
+        {
+            return false;      // Unknown command, length of the remaining commands unknown
+        }
+        if (command == MCMD_LinkCheckAns && i + 2 < length)
+        {
+            margin = commands[i + 1];
+            gatewayCount = commands[i + 2];
+            return true;
+        }
+        i += macCommandLength[command - MCMD_LinkCheckAns];
+    }
+    return false;
+}
+
+
+void processLinkCheck(ostime_t timestamp)
+{
+    // Called on EV_TXCOMPLETE. Adjusts data rate and transmit power
+    // for the answer to a LinkCheckReq sent with this uplink, or 
+    // for a link check that was not answered.
+    if (!dataRateController.pending())
+    {
+        return;
+    }
+    uint8_t margin;
+    uint8_t gatewayCount;
+    dr_t dataRate = LMIC.datarate;
+    s1_t txPower = LMIC.adrTxPow;
+    bool answered = readLinkCheckAns(margin, gatewayCount);
+    bool changed = answered ? dataRateController.answered(margin, gatewayCount, dataRate, txPower)
+                            : dataRateController.missed(dataRate, txPower);
+    if (!changed)
+    {
+        return;
+    }
+    LMIC_setDrTxpow(dataRate, txPower);
+
+    #ifdef USE_BINARY_LOG
+        logRecord(timestamp, static_cast<uint8_t>(LogCode::DataRateChanged), 0, txPower, dataRate, 
+                  answered ? margin : -1);
+    #elif defined(USE_SERIAL)
+        printEvent(timestamp, "Data rate changed", PrintTarget::Serial);
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("DR: "));
+        serialLog.print(dataRate);
+        serialLog.print(F(",  TX power: "));
+        serialLog.print(txPower);
+        serialLog.print(F(" dBm,  "));
+        if (answered)
+        {
+            serialLog.print(F("margin: "));
+            serialLog.print(margin);
+            serialLog.print(F(" dB,  gateways: "));
+            serialLog.println(gatewayCount);
+        }
+        else
+        {
+            serialLog.println(F("link check not answered"));
+        }
+    #endif
+    #ifdef USE_DISPLAY
+        printEvent(timestamp, "DR changed", PrintTarget::Display, false);
+    #endif
+}
+#endif
+
+
+#ifdef USE_JOIN_SCHEDULE
+static osjob_t joinJob;
+
+static void joinCallback(osjob_t* job)
+{
+    // Starts a join attempt at the data rate of the join schedule.
+    // LMIC_startJoining() selects its own initial join data rate, 
+    // which is replaced before the join request is sent.
+    dr_t dataRate = joinScheduler.nextDataRate();
+    #ifdef USE_SUBBAND_DISCOVERY
+        // LMIC_unjoin() may have enabled all channels again.
+        LMIC_selectSubBand(subBandSelector.subBand());
+    #endif
+    LMIC_startJoining();
+    LMIC_setDrTxpow(dataRate, KEEP_TXPOW);
+    joinScheduler.attemptStarted(dataRate);
+}
+
+
+static void joinBackoffCallback(osjob_t* job)
+{
+    // Stops the join retries of LMIC and schedules the next attempt.
+    // Random numbers are from the DevEUI seeded generator, so nodes
+    // that start together spread their attempts.
+    LMIC_unjoin();
+    ostime_t timestamp = os_getTime();
+    uint32_t backoffMs = joinScheduler.backoffMs(millis(), doWorkJitterRandom());
+    os_setTimedCallback(&joinJob, timestamp + ms2osticks(backoffMs), joinCallback);
+
+    dr_t nextDataRate = joinScheduler.nextDataRate();
+    #ifdef USE_BINARY_LOG
+        logRecord(timestamp, static_cast<uint8_t>(LogCode::JoinBackoff), 0, 0, nextDataRate,
+                  backoffMs / 1000 < 0x7FFF ? backoffMs / 1000 : 0x7FFF);
+    #elif defined(USE_SERIAL)
+        printEvent(timestamp, "Join backoff", PrintTarget::Serial);
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("Next attempt in "));
+        serialLog.print(backoffMs / 1000);
+        serialLog.print(F(" s,  DR: "));
+        serialLog.println(nextDataRate);
+    #endif
+    #ifdef USE_DISPLAY
+        printEvent(timestamp, "Join backoff", PrintTarget::Display, false);
+    #endif
+}
+
+
+void startJoinSchedule()
+{
+    // Starts joining after a random delay of up to JOIN_START_JITTER_SECONDS.
+    joinScheduler.start(millis());
+    uint32_t delayMs = doWorkJitterRandom() % (JOIN_START_JITTER_SECONDS * 1000UL + 1);
+    os_setTimedCallback(&joinJob, os_getTime() + ms2osticks(delayMs), joinCallback);
+}
+
+
+void scheduleNextJoin(ostime_t timestamp)
+{
+    // Called on EV_JOIN_TXCOMPLETE. The backoff is handled in a separate
+    // job, after LMIC has finished processing the failed attempt.
+    os_setCallback(&joinJob, joinBackoffCallback);
+}
+
+
+bool processJoined(ostime_t timestamp)
+{
+    // Called on EV_JOINED. Schedules the join report (number of attempts
+    // and join latency) as the first uplink. Returns true if it was scheduled.
+    joinScheduler.joined(millis());
+    #ifdef USE_BINARY_LOG
+        uint32_t latencySeconds = joinScheduler.latencyMs() / 1000;
+        logRecord(timestamp, static_cast<uint8_t>(LogCode::JoinReport), 0, 
+                  joinScheduler.attempts() < 0xFF ? joinScheduler.attempts() : 0xFF, joinScheduler.dataRate(),
+                  latencySeconds < 0x7FFF ? latencySeconds : 0x7FFF);
+    #elif defined(USE_SERIAL)
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("Join attempts: "));
+        serialLog.print(joinScheduler.attempts());
+        serialLog.print(F(",  latency: "));
+        serialLog.print(joinScheduler.latencyMs() / 1000);
+        serialLog.print(F(" s,  DR: "));
+        serialLog.println(joinScheduler.dataRate());
+    #endif
+
+    uint8_t payload[JOIN_REPORT_PAYLOAD_LENGTH];
+    uint8_t payloadLength = joinScheduler.encode(payload, sizeof(payload));
+    if (scheduleUplink(JOIN_REPORT_FPORT, payload, payloadLength) != LMIC_ERROR_SUCCESS)
+    {
+        joinScheduler.reportSent();
+        return false;
+    }
+    return true;
+}
+#endif
+
+
+#ifdef USE_SUBBAND_DISCOVERY
+void processSubBandJoinFailed(ostime_t timestamp)
+{
+    // Called on EV_JOIN_TXCOMPLETE (no join-accept received).
+    // Moves to the next sub-band after SUBBAND_JOIN_ATTEMPTS failed attempts.
+    if (!subBandSelector.joinFailed())
+    {
+        return;
+    }
+    #ifndef USE_JOIN_SCHEDULE
+        // LMIC selects the channel for its next attempt after this event.
+        // With USE_JOIN_SCHEDULE the sub-band is selected in joinCallback().
+        LMIC_selectSubBand(subBandSelector.subBand());
+    #endif
+
+    #ifdef USE_BINARY_LOG
+        logRecord(timestamp, LogCode::SubBandChanged, 0, 0, subBandSelector.subBand());
+    #elif defined(USE_SERIAL)
+        printEvent(timestamp, "Sub-band changed", PrintTarget::Serial);
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("Next join attempts on sub-band "));
+        serialLog.println(subBandSelector.subBand());
+    #endif
+    #ifdef USE_DISPLAY
+        printEvent(timestamp, "Sub-band changed", PrintTarget::Display, false);
+    #endif
+}
+
+
+void processSubBandJoined(ostime_t timestamp)
+{
+    // Called on EV_JOINED. Stores the working sub-band so that
+    // after a restart (or rejoin) joining starts on this sub-band.
+    subBandSelector.joined();
+    #ifdef STORAGE_SIZE
+        SettingsRecord settings;
+        loadSettings(settings);
+        if (settings.subBand != subBandSelector.subBand() + 1)
+        {
+            settings.subBand = subBandSelector.subBand() + 1;
+            storeSettings(settings);
+        }
+    #endif
+    #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.print(F("Sub-band: "));
+        serialLog.println(subBandSelector.subBand());
+    #endif
+}
+#endif
+
+
+#ifdef USE_LINK_QUALITY
+void updateLinkQuality()
+{
+    // Called on EV_TXCOMPLETE. Adds the signal quality of a received
+    // downlink (which can be an ACK without payload) and the ACK result
+    // of a confirmed uplink to the link quality statistics.
+    if (LMIC.txrxFlags & (TXRX_DNW1 | TXRX_DNW2))
+    {
+        int16_t snrTenfold = getSnrTenfold();
+        linkQuality.addDownlink(getRssi(snrTenfold / 10), snrTenfold, LMIC.seqnoDn);
+    }
+    if (LMIC.txrxFlags & (TXRX_ACK | TXRX_NACK))
+    {
+        linkQuality.addAck(LMIC.txrxFlags & TXRX_ACK);
+    }
+}
+
+
+void sendLinkQualityUplink()
+{
+    // Sends the link quality statistics on LINK_QUALITY_FPORT after every 
+    // LINK_QUALITY_UPLINK_EVERY other uplinks. Is called on EV_TXCOMPLETE.
+    // If LMIC is busy the diagnostics uplink is sent after the next uplink.
+    #if LINK_QUALITY_UPLINK_EVERY > 0
+        static uint16_t uplinkCount = 0;
+        if (LMIC.pendTxPort != LINK_QUALITY_FPORT && uplinkCount < LINK_QUALITY_UPLINK_EVERY)
+        {
+            ++uplinkCount;
+        }
+        if (uplinkCount < LINK_QUALITY_UPLINK_EVERY || LMIC.devaddr == 0 
+            || (LMIC.opmode & (OP_JOINING | OP_TXDATA | OP_TXRXPEND)))
+        {
+            return;
+        }
+        uint8_t payload[LINK_QUALITY_PAYLOAD_LENGTH];
+        uint8_t payloadLength = linkQuality.encode(payload, sizeof(payload));
+        // Errors are reported by scheduleUplink(), a failed uplink is not retried.
+        scheduleUplink(LINK_QUALITY_FPORT, payload, payloadLength);
+        uplinkCount = 0;
+    #endif
+}
+#endif
+
+
+#ifdef USE_FRAGMENTATION
+void sendNextFragment()
+{
+    // Schedules the next fragment of a fragmented message if LMIC is ready
+    // to accept a new uplink. Is called when fragmentation starts and on 
+    // EV_TXCOMPLETE, so fragments are sent back-to-back.
+    // Fragment size is determined by the data rate at that time.
+
+    if (!uplinkFragmenter.pending() || LMIC.devaddr == 0 
+        || (LMIC.opmode & (OP_JOINING | OP_TXDATA | OP_TXRXPEND)))
+    {
+        return;
+    }
+
+    uint8_t fragmentLength;
+    uint8_t* fragment = uplinkFragmenter.next(maxUplinkPayloadLength(), fragmentLength);
+    if (fragment == nullptr)
+    {
+        // Pending MAC command responses leave no room for fragment data.
+        // Send them in an empty frame, the fragment follows on EV_TXCOMPLETE.
+        LMIC_sendAlive();
+        return;
+    }
+    if (scheduleUplink(FRAGMENT_FPORT, fragment, fragmentLength, uplinkFragmenter.confirmed()) != LMIC_ERROR_SUCCESS)
+    {
+        // The remaining fragments are useless without this one.
+        uplinkFragmenter.cancel();
+    }
+}
+#endif
+
+
+#ifdef USE_UPLINK_QUEUE
+void sendQueuedUplink()
+{
+    // Schedules the next message from the uplink queue if LMIC is ready
+    // to accept a new uplink. Is called when a message is queued and on 
+    // EV_TXCOMPLETE, so queued messages are sent back-to-back
+    // (as soon as duty cycle allows).
+
+    if (LMIC.devaddr == 0 || (LMIC.opmode & (OP_JOINING | OP_TXDATA | OP_TXRXPEND)))
+    {
+        return;
+    }
+    #ifdef USE_FRAGMENTATION
+        if (uplinkFragmenter.pending())
+        {
+            return;
+        }
+    #endif
+
+    ostime_t timestamp = os_getTime();
+    uint8_t expired = uplinkQueue.removeExpired(timestamp);
+    if (expired != 0)
+    {
+        #ifdef USE_BINARY_LOG
+            logRecord(timestamp, LogCode::UplinkExpired, 0, 0, expired);
+        #elif defined(USE_SERIAL)
+            printEvent(timestamp, "Queued uplink(s) expired", PrintTarget::Serial);
+        #endif
+    }
+
+    QueuedUplink* next;
+    while ((next = uplinkQueue.front()) != nullptr)
+    {
+        // Errors are reported by scheduleUplink(). A message that cannot be
+        // scheduled (e.g. too large for the current data rate) stays queued 
+        // and is tried again when the next message is queued or on 
+        // EV_TXCOMPLETE, until it has failed UPLINK_QUEUE_MAX_ATTEMPTS times.
+        if (scheduleUplink(next->fPort, next->data, next->length, next->confirmed) == LMIC_ERROR_SUCCESS)
+        {
+            uplinkQueue.pop();
+            return;
+        }
+        if (++next->attempts < UPLINK_QUEUE_MAX_ATTEMPTS)
+        {
+            return;
+        }
+        timestamp = os_getTime();
+        #ifdef USE_BINARY_LOG
+            logRecord(timestamp, LogCode::UplinkDropped, next->fPort, next->length, next->attempts);
+        #elif defined(USE_SERIAL)
+            printEvent(timestamp, "Queued uplink not sent, message dropped", PrintTarget::Serial);
+        #endif
+        #ifdef USE_DISPLAY
+            printEvent(timestamp, "UL dropped", PrintTarget::Display);
+        #endif
+        // Try the next message.
+        uplinkQueue.drop();
+    }
+}
+
+
+bool queueUplink(uint8_t fPort, uint8_t* data, uint8_t dataLength, uint8_t priority = 0,
+                 uint16_t maxAgeSeconds = 0, bool confirmed = false)
+{
+    // Adds an uplink message to the uplink queue. If LMIC is ready 
+    // the message is scheduled for transmission immediately.
+    // Higher priority messages are sent first. A message that has not
+    // been sent within maxAgeSeconds is discarded (0 is no max age).
+    // Returns false if the message was dropped because the queue is full.
+
+    ostime_t timestamp = os_getTime();
+    uint32_t dropped = uplinkQueue.dropped();
+    bool queued = uplinkQueue.push(timestamp, fPort, data, dataLength, priority, maxAgeSeconds, confirmed);
+    if (uplinkQueue.dropped() != dropped)
+    {
+        #ifdef USE_BINARY_LOG
+            logRecord(timestamp, LogCode::UplinkDropped, fPort, dataLength);
+        #elif defined(USE_SERIAL)
+            printEvent(timestamp, "Uplink queue full, message dropped", PrintTarget::Serial);
+        #endif
+        #ifdef USE_DISPLAY
+            printEvent(timestamp, "UL dropped", PrintTarget::Display);
+        #endif
+    }
+    sendQueuedUplink();
+    return queued;
+}
+#endif
+
+
+uint8_t dispatchDownlink(ostime_t timestamp, uint8_t fPort, const uint8_t* data, uint8_t dataLength,
+                         const DownlinkCommand* commands, uint8_t commandCount)
+{
+    // Calls the handler from commands for each command in the downlink.
+    // Parses the frame in place, command values are not copied.
+    // Unknown commands and commands with an invalid length are skipped.
+    // Parsing stops at a command that extends beyond the end of the frame.
+    // Downlinks on ports without commands are ignored.
+    // Returns the number of commands handled.
+
+    bool portHasCommands = false;
+    for (uint8_t i = 0; i < commandCount && !portHasCommands; ++i)
+    {
+        portHasCommands = commands[i].fPort == fPort;
+    }
+    if (!portHasCommands)
+    {
+        return 0;
+    }
+
+    uint8_t handled = 0;
+    uint8_t offset = 0;
+    while (offset < dataLength)
+    {
+        uint8_t opcode = data[offset++];
+        uint8_t length = offset < dataLength ? data[offset++] : 0;
+        if (length > dataLength - offset)
+        {
+            #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
+                printEvent(timestamp, "Malformed downlink command", PrintTarget::Serial);
+            #endif
+            break;
+        }
+        const DownlinkCommand* command = nullptr;
+        for (uint8_t i = 0; i < commandCount; ++i)
+        {
+            if (commands[i].fPort == fPort && commands[i].opcode == opcode)
+            {
+                command = &commands[i];
+                break;
+            }
+        }
+        if (command != nullptr && length >= command->minLength && length <= command->maxLength)
+        {
+            command->handler(timestamp, data + offset, length);
+            ++handled;
+        }
+        else
+        {
+            #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
+                printEvent(timestamp, "Unsupported downlink command", PrintTarget::Serial);
+            #endif
+        }
+        offset += length;
+    }
+    return handled;
+}
+
+
 //  █ █ █▀▀ █▀▀ █▀▄   █▀▀ █▀█ █▀▄ █▀▀   █▀▄ █▀▀ █▀▀ ▀█▀ █▀█
 //  █ █ ▀▀█ █▀▀ █▀▄   █   █ █ █ █ █▀▀   █▀▄ █▀▀ █ █  █  █ █
 //  ▀▀▀ ▀▀▀ ▀▀▀ ▀ ▀   ▀▀▀ ▀▀▀ ▀▀  ▀▀▀   ▀▀  ▀▀▀ ▀▀▀ ▀▀▀ ▀ ▀
@@ -732,72 +1772,226 @@ void processWork(ostime_t doWorkJobTimeStamp)
         #ifdef USE_DISPLAY
             // Interval and Counter values are combined on a single row.
             // This allows to keep the 3rd row empty which makes the
-            // information better readable on the small display.
-            display.clearLine(INTERVAL_ROW);
-            display.setCursor(COL_0, INTERVAL_ROW);
-            display.print("I:");
-            display.print(doWorkIntervalSeconds);
-            display.print("s");        
-            display.print(" Ctr:");
-            display.print(counterValue);
+            // information better readable on the small screen.
+            screen.clearLine(INTERVAL_ROW);
+            screen.setCursor(COL_0, INTERVAL_ROW);
+            screen.print("I:");
+            screen.print(doWorkIntervalSeconds);
+            screen.print("s");        
+            screen.print(" Ctr:");
+            screen.print(counterValue);
         #endif
-        #ifdef USE_SERIAL
+        #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
             printEvent(timestamp, "Input data collected", PrintTarget::Serial);
-            printSpaces(serial, MESSAGE_INDENT);
-            serial.print(F("COUNTER value: "));
-            serial.println(counterValue);
+            printSpaces(serialLog, MESSAGE_INDENT);
+            serialLog.print(F("COUNTER value: "));
+            serialLog.println(counterValue);
         #endif    
 
         // For simplicity LMIC-node will try to send an uplink
         // message every time processWork() is executed.
 
-        // Schedule uplink message if possible
-        if (LMIC.opmode & OP_TXRXPEND)
-        {
-            // TxRx is currently pending, do not send.
-            #ifdef USE_SERIAL
-                printEvent(timestamp, "Uplink not scheduled because TxRx pending", PrintTarget::Serial);
-            #endif    
-            #ifdef USE_DISPLAY
-                printEvent(timestamp, "UL not scheduled", PrintTarget::Display);
+        #ifdef USE_SAMPLE_BATCH
+            // Collect samples and send them together in a single uplink 
+            // when the batch is full or when no more samples will fit
+            // in the max payload length for the current data rate.
+            if (!sampleBatch.add(counterValue))
+            {
+                // Uplinks could not be sent for a while (e.g. TxRx pending or 
+                // a slower data rate), the batch is full.
+                uint32_t dropped = sampleBatch.overwritten();
+                #ifdef USE_BINARY_LOG
+                    logRecord(timestamp, static_cast<uint8_t>(LogCode::SampleDropped), 0, 0, 0,
+                              dropped < 0x7FFF ? dropped : 0x7FFF);
+                #elif defined(USE_SERIAL)
+                    printEvent(timestamp, "Batch full, oldest sample dropped", PrintTarget::Serial);
+                    printSpaces(serialLog, MESSAGE_INDENT);
+                    serialLog.print(F("Samples dropped: "));
+                    serialLog.println(dropped);
+                #endif
+                (void)dropped;
+            }
+            uint8_t maxLength = maxUplinkPayloadLength();
+            maxLength = (maxLength < payloadBufferLength ? maxLength : payloadBufferLength) 
+                        - SAMPLE_BATCH_HEADER_LENGTH;
+            #ifdef SAMPLE_BATCH_COMPRESS
+                if (sampleBatch.count() < SAMPLE_BATCH_SIZE && sampleBatch.compressedLength() < maxLength)
+                {
+                    return;
+                }
+            #else
+                uint8_t maxSamples = maxLength * 8 / SAMPLE_BATCH_SAMPLE_BITS;
+                if (sampleBatch.count() < SAMPLE_BATCH_SIZE && sampleBatch.count() < maxSamples)
+                {
+                    return;
+                }
             #endif
-        }
-        else
-        {
+            #ifdef USE_AIRTIME_GOVERNOR
+                // Wait until the airtime budget allows the next uplink,
+                // more samples are collected in the batch meanwhile.
+                if (!airtimeGovernor.uplinkDue())
+                {
+                    return;
+                }
+            #endif
+
+            // Prepare uplink payload: 
+            // sample interval (seconds) followed by the samples, oldest first.
+            uint32_t sampleInterval = doWorkIntervalSeconds;
+            #ifdef USE_AIRTIME_GOVERNOR
+                // Sampling may have been slowed down for the airtime budget.
+                if (governedIntervalSeconds != 0)
+                {
+                    sampleInterval = governedIntervalSeconds;
+                }
+            #endif
+            uint16_t interval = sampleInterval < 0xFFFF ? sampleInterval : 0xFFFF;
+            #ifdef SAMPLE_BATCH_COMPRESS
+                // Samples that do not fit remain in the batch for the next uplink.
+                uint8_t fPort = 12;
+                payloadBuffer[0] = interval >> 8;
+                payloadBuffer[1] = interval & 0xFF;
+                DeltaCompressor compressor(payloadBuffer + SAMPLE_BATCH_HEADER_LENGTH, maxLength);
+                uint8_t batchSamplesDone = sampleBatch.compress(compressor);
+                uint8_t payloadLength = SAMPLE_BATCH_HEADER_LENGTH + compressor.length();
+            #else
+                // Samples that do not fit remain in the batch for the next uplink.
+                uint8_t fPort = 11;
+                BitWriter writer(payloadBuffer, payloadBufferLength);
+                writer.write(interval, SAMPLE_BATCH_HEADER_LENGTH * 8);
+                uint8_t batchSamplesDone = sampleBatch.pack(writer, maxSamples);
+                uint8_t payloadLength = writer.length();
+            #endif
+        #else
             // Prepare uplink payload.
+            // The payload layout is defined in uplink-schema.h.
             uint8_t fPort = 10;
-            payloadBuffer[0] = counterValue >> 8;
-            payloadBuffer[1] = counterValue & 0xFF;
-            uint8_t payloadLength = 2;
+            UplinkData uplinkData;
+            uplinkData.counter = counterValue;
+            #ifdef USE_REPORT_ON_CHANGE
+                // Only send if the data has changed outside the deadbands 
+                // (uplink-schema.h) or if nothing was sent for too long.
+                if (!reportPolicy.due(uplinkData, doWorkJobTimeStamp))
+                {
+                    #ifdef USE_BINARY_LOG
+                        logRecord(timestamp, LogCode::NoChange);
+                    #elif defined(USE_SERIAL)
+                        printEvent(timestamp, "No significant change, uplink skipped", PrintTarget::Serial);
+                    #endif
+                    return;
+                }
+            #endif
+            uint8_t payloadLength = encodeUplink(uplinkData, payloadBuffer);
+        #endif
 
-            scheduleUplink(fPort, payloadBuffer, payloadLength);
-        }
+        #ifdef USE_UPLINK_QUEUE
+            // Queue the uplink, it will be sent when LMIC is ready.
+            // No readings are lost when TxRx is pending.
+            if (queueUplink(fPort, payloadBuffer, payloadLength))
+            {
+                #ifdef USE_SAMPLE_BATCH
+                    // Samples that were not queued are sent with the next uplink.
+                    sampleBatch.remove(batchSamplesDone);
+                #endif
+                #ifdef USE_REPORT_ON_CHANGE
+                    reportPolicy.reported(uplinkData, doWorkJobTimeStamp);
+                #endif
+            }
+        #else
+            // Schedule uplink message if possible
+            if (LMIC.opmode & OP_TXRXPEND)
+            {
+                // TxRx is currently pending, do not send.
+                #ifdef USE_BINARY_LOG
+                    logRecord(timestamp, LogCode::UplinkNotScheduled);
+                #elif defined(USE_SERIAL)
+                    printEvent(timestamp, "Uplink not scheduled because TxRx pending", PrintTarget::Serial);
+                #endif    
+                #ifdef USE_DISPLAY
+                    printEvent(timestamp, "UL not scheduled", PrintTarget::Display);
+                #endif
+            }
+            else
+            {
+                lmic_tx_error_t error = scheduleUplink(fPort, payloadBuffer, payloadLength);
+                #ifdef USE_SAMPLE_BATCH
+                    if (error == LMIC_ERROR_SUCCESS)
+                    {
+                        sampleBatch.remove(batchSamplesDone);
+                    }
+                #endif
+                #ifdef USE_REPORT_ON_CHANGE
+                    if (error == LMIC_ERROR_SUCCESS)
+                    {
+                        reportPolicy.reported(uplinkData, doWorkJobTimeStamp);
+                    }
+                #endif
+                (void)error;
+            }
+        #endif
     }
 }    
  
 
-void processDownlink(ostime_t txCompleteTimestamp, uint8_t fPort, uint8_t* data, uint8_t dataLength)
+void resetCounterCommand(ostime_t timestamp, const uint8_t* value, uint8_t length)
 {
-    // This function is called from the onEvent() event handler
-    // on EV_TXCOMPLETE when a downlink message was received.
-
     // Implements a 'reset counter' command that can be sent via a downlink message.
     // To send the reset counter command to the node, send a downlink message
-    // (e.g. from the TTN Console) with single byte value resetCmd on port cmdPort.
+    // (e.g. from the TTN Console) with single byte value 0xC0 on port 100.
+
+    #if defined(USE_SERIAL) && !defined(USE_BINARY_LOG)
+        printSpaces(serialLog, MESSAGE_INDENT);
+        serialLog.println(F("Reset cmd received"));
+    #endif
+    resetCounter();
+    printEvent(os_getTime(), "Counter reset", PrintTarget::All, false);
+}
+
 
-    const uint8_t cmdPort = 100;
-    const uint8_t resetCmd= 0xC0;
+void setIntervalCommand(ostime_t timestamp, const uint8_t* value, uint8_t length)
+{
+    // Implements a 'set interval' command that can be sent via a downlink message.
+    // Opcode 0xC1 on port 100, value is the new doWork interval in seconds
+    // (1 to 4 bytes, most significant byte first). E.g. C1 02 01 2C sets 300 seconds.
+    // The new interval is saved and remains in effect after a restart.
 
-    if (fPort == cmdPort && dataLength == 1 && data[0] == resetCmd)
+    uint32_t seconds = 0;
+    for (uint8_t i = 0; i < length; ++i)
     {
-        #ifdef USE_SERIAL
-            printSpaces(serial, MESSAGE_INDENT);
-            serial.println(F("Reset cmd received"));
-        #endif
-        ostime_t timestamp = os_getTime();
-        resetCounter();
-        printEvent(timestamp, "Counter reset", PrintTarget::All, false);
-    }          
+        seconds = (seconds << 8) | value[i];
+    }
+    setDoWorkInterval(seconds);
+}
+
+
+#ifdef USE_CONFIRM_POLICY
+bool isCriticalFPort(uint8_t fPort)
+{
+    // Uplinks on critical fPorts are always sent confirmed (USE_CONFIRM_POLICY).
+    // E.g. return fPort == 20 || fPort == 21;
+    return false;
+}
+#endif
+
+
+// Downlink commands: fPort, opcode, min and max value length, handler.
+// Add your own commands here.
+const DownlinkCommand downlinkCommands[] =
+{
+    { 100, 0xC0, 0, 0, resetCounterCommand },
+    { 100, 0xC1, 1, 4, setIntervalCommand },
+};
+
+
+void processDownlink(ostime_t txCompleteTimestamp, uint8_t fPort, uint8_t* data, uint8_t dataLength)
+{
+    // This function is called from the onEvent() event handler
+    // on EV_TXCOMPLETE when a downlink message was received.
+
+    // Calls the handlers in downlinkCommands for the commands in the downlink.
+    // A single downlink can contain multiple commands.
+    dispatchDownlink(txCompleteTimestamp, fPort, data, dataLength, 
+                     downlinkCommands, sizeof(downlinkCommands) / sizeof(downlinkCommands[0]));
 }
 
 
@@ -821,6 +2015,19 @@ void setup()
 
     boardInit(InitType::PostInitSerial);
 
+    #ifdef STORAGE_SIZE
+        // Settings changed at runtime override the defaults from platformio.ini.
+        storageReady = storageInit();
+        SettingsRecord settings;
+        if (loadSettings(settings) && settings.doWorkIntervalSeconds != 0)
+        {
+            doWorkIntervalSeconds = settings.doWorkIntervalSeconds;
+        }
+        #ifdef USE_SUBBAND_DISCOVERY
+            subBandSelector.begin(settings.subBand);
+        #endif
+    #endif
+
     #if defined(USE_SERIAL) || defined(USE_DISPLAY)
         printHeader();
     #endif
@@ -828,18 +2035,24 @@ void setup()
     if (!hardwareInitSucceeded)
     {   
         #ifdef USE_SERIAL
-            serial.println(F("Error: hardware init failed."));
-            serial.flush();            
+            serialLog.println(F("Error: hardware init failed."));
+            serialLog.flush();            
         #endif
         #ifdef USE_DISPLAY
             // Following mesage shown only if failure was unrelated to I2C.
-            display.setCursor(COL_0, FRMCNTRS_ROW);
-            display.print(F("HW init failed"));
+            screen.setCursor(COL_0, FRMCNTRS_ROW);
+            screen.print(F("HW init failed"));
+            updateDisplay(true);
         #endif
         abort();
     }
 
-    initLmic();
+    #ifdef USE_MOBILE_DATA_RATE
+        // Data rate and transmit power are controlled by the node.
+        initLmic(0);
+    #else
+        initLmic();
+    #endif
 
 //  █ █ █▀▀ █▀▀ █▀▄   █▀▀ █▀█ █▀▄ █▀▀   █▀▄ █▀▀ █▀▀ ▀█▀ █▀█
 //  █ █ ▀▀█ █▀▀ █▀▄   █   █ █ █ █ █▀▀   █▀▄ █▀▀ █ █  █  █ █
@@ -853,17 +2066,42 @@ void setup()
 //  █ █ ▀▀█ █▀▀ █▀▄   █   █ █ █ █ █▀▀   █▀▀ █ █ █ █
 //  ▀▀▀ ▀▀▀ ▀▀▀ ▀ ▀   ▀▀▀ ▀▀▀ ▀▀  ▀▀▀   ▀▀▀ ▀ ▀ ▀▀ 
 
-    if (activationMode == ActivationMode::OTAA)
+    if (activationMode == ActivationMode::OTAA && !sessionRestored)
     {
-        LMIC_startJoining();
+        #ifdef USE_JOIN_SCHEDULE
+            startJoinSchedule();
+        #else
+            LMIC_startJoining();
+        #endif
     }
 
-    // Schedule initial doWork job for immediate execution.
-    os_setCallback(&doWorkJob, doWorkCallback);
+    // Schedule initial doWork job for immediate execution 
+    // (plus the phase offset if DO_WORK_JITTER_SECONDS is set).
+    startDoWorkSchedule(os_getTime());
 }
 
 
 void loop() 
 {
     os_runloop_once();
+
+    #ifdef USE_DISPLAY
+        // Transfer changed display content in between LMIC jobs,
+        // at a limited rate and not when an RX window is imminent.
+        updateDisplay();
+    #endif
+
+    #if defined(USE_SERIAL) && defined(USE_SERIAL_LOG_BUFFER)
+        // Write buffered serial output in between LMIC jobs,
+        // but not when an RX window (or other LMIC job) is imminent.
+        if (serialLog.pending() != 0 && !timeCriticalJobsPending(SERIAL_LOG_GUARD_MS))
+        {
+            serialLog.drain();
+        }
+    #endif
+
+    #ifdef USE_SLEEP
+        // Sleep until the next doWork job when there is nothing else to do.
+        sleepUntil(doWorkJob.deadline);
+    #endif
 }
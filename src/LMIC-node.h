@@ -48,15 +48,48 @@ const s1_t DefaultABPTxPower =  14;
 
 // Forward declarations
 static void doWorkCallback(osjob_t* job);
+void scheduleDoWork(ostime_t nominalTime, bool jitter = false);
+void startDoWorkSchedule(ostime_t startTime);
 void processWork(ostime_t timestamp);
 void processDownlink(ostime_t eventTimestamp, uint8_t fPort, uint8_t* data, uint8_t dataLength);
 void onLmicEvent(void *pUserData, ev_t ev);
 void displayTxSymbol(bool visible);
+#ifdef USE_UPLINK_QUEUE
+    void sendQueuedUplink();
+#endif
+#ifdef USE_FRAGMENTATION
+    void sendNextFragment();
+#endif
+#ifdef USE_CONFIRM_POLICY
+    bool isCriticalFPort(uint8_t fPort);
+    void processAck(ostime_t timestamp);
+#endif
+#ifdef USE_JOIN_SCHEDULE
+    void startJoinSchedule();
+    void scheduleNextJoin(ostime_t timestamp);
+    bool processJoined(ostime_t timestamp);
+#endif
+#ifdef USE_MOBILE_DATA_RATE
+    bool requestLinkCheck(uint8_t dataLength);
+    void processLinkCheck(ostime_t timestamp);
+#endif
+#ifdef USE_LINK_QUALITY
+    void updateLinkQuality();
+    void sendLinkQualityUplink();
+#endif
+#ifdef USE_SUBBAND_DISCOVERY
+    void processSubBandJoinFailed(ostime_t timestamp);
+    void processSubBandJoined(ostime_t timestamp);
+#endif
 
 #ifndef DO_WORK_INTERVAL_SECONDS            // Should be set in platformio.ini
     #define DO_WORK_INTERVAL_SECONDS 300    // Default 5 minutes if not set
 #endif    
 
+#ifndef DO_WORK_JITTER_SECONDS              // Per device phase offset (0 .. n seconds) of the doWork
+    #define DO_WORK_JITTER_SECONDS 0        // schedule to spread uplinks of nodes started together
+#endif
+
 #define TIMESTAMP_WIDTH 12 // Number of columns to display eventtime (zero-padded)
 #define MESSAGE_INDENT TIMESTAMP_WIDTH + 3
 
@@ -71,6 +104,12 @@ void displayTxSymbol(bool visible);
     #define OTAA_ACTIVATION
 #endif
 
+#if defined(CFG_us915) || defined(CFG_au915)
+    #ifndef SUBBAND
+        #define SUBBAND 1   // Sub-band (0-7) used by the gateways, TTN uses the second (1)
+    #endif
+#endif
+
 enum class ActivationMode {OTAA, ABP};
 #ifdef OTAA_ACTIVATION
     const ActivationMode activationMode = ActivationMode::OTAA;
@@ -81,6 +120,8 @@ enum class ActivationMode {OTAA, ABP};
 
 #include BSFILE // Include Board Support File
 #include "../keyfiles/lorawan-keys.h"
+#include "uplink-schema.h"
+#include "payload-encoding.h"
 
     
 #if defined(ABP_ACTIVATION) && defined(OTAA_ACTIVATION)
@@ -150,6 +191,8 @@ enum class ActivationMode {OTAA, ABP};
 
 #ifndef MCCI_LMIC
     #define LMIC_ERROR_SUCCESS 0
+    #define LMIC_ERROR_TX_BUSY -1               // Same values as MCCI LMIC
+    #define LMIC_ERROR_TX_NOT_FEASIBLE -3
     typedef int lmic_tx_error_t;
 
     // In MCCI LMIC these are already defined.
@@ -186,6 +229,92 @@ enum class ActivationMode {OTAA, ABP};
     #endif
         
 
+    // Allocation free formatting.
+    // Below functions format a value into a caller provided buffer.
+    // They do not use the heap (String) and do not use printf() 
+    // which is not default supported/enabled in each Arduino core.
+    // The result is null terminated. Returns the number of characters
+    // written, excluding the terminating null character.
+
+    #define FORMAT_NUMBER_SIZE 12   // Buffer size for any 32-bit value incl. sign and null
+
+    uint8_t formatUnsigned(char* buffer, uint32_t value, uint8_t width = 0, uint8_t base = DEC, char padChar = '0')
+    {
+        // Formats value right aligned and padded with padChar to (at least) width characters.
+        // Supported bases are DEC and HEX. Buffer must also fit width + 1 characters.
+        char digits[FORMAT_NUMBER_SIZE];
+        uint8_t digitCount = 0;
+        do
+        {
+            uint8_t digit = value % base;
+            digits[digitCount++] = digit < 10 ? '0' + digit : 'A' + digit - 10;
+            value /= base;
+        } while (value != 0);
+
+        uint8_t len = 0;
+        while (len + digitCount < width)
+        {
+            buffer[len++] = padChar;
+        }
+        while (digitCount > 0)
+        {
+            buffer[len++] = digits[--digitCount];
+        }
+        buffer[len] = '\0';
+        return len;
+    }
+
+
+    uint8_t formatSigned(char* buffer, int32_t value, uint8_t width = 0, char padChar = '0')
+    {
+        // Formats value in decimal, padded with padChar to (at least) width characters.
+        // The minus sign precedes the padding.
+        if (value < 0)
+        {
+            buffer[0] = '-';
+            return 1 + formatUnsigned(buffer + 1, 0UL - (uint32_t)value, width > 1 ? width - 1 : 0, DEC, padChar);
+        }
+        return formatUnsigned(buffer, (uint32_t)value, width, DEC, padChar);
+    }
+
+
+    uint8_t formatTenfold(char* buffer, int16_t tenfoldValue)
+    {
+        // Formats ten times a value as fixed-point with 1 decimal digit,
+        // e.g. -75 is formatted as -7.5 and -5 as -0.5.
+        uint8_t len = 0;
+        uint16_t absValue = tenfoldValue;
+        if (tenfoldValue < 0)
+        {
+            buffer[len++] = '-';
+            absValue = -tenfoldValue;
+        }
+        len += formatUnsigned(buffer + len, absValue / 10);
+        buffer[len++] = '.';
+        buffer[len++] = '0' + absValue % 10;
+        buffer[len] = '\0';
+        return len;
+    }
+
+
+    uint16_t formatHex(char* buffer, const uint8_t* bytes, size_t length, char separator = 0)
+    {
+        // Formats bytes as 2 digit hex values, optionally separated by separator.
+        // Buffer size must be at least 3 * length (with separator) or 2 * length + 1.
+        uint16_t len = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (i > 0 && separator != 0)
+            {
+                buffer[len++] = separator;
+            }
+            len += formatUnsigned(buffer + len, bytes[i], 2, HEX);
+        }
+        buffer[len] = '\0';
+        return len;
+    }
+
+
     void printChars(Print& printer, char ch, uint8_t count, bool linefeed = false)
     {
         for (uint8_t i = 0; i < count; ++i)
@@ -251,6 +380,71 @@ enum class ActivationMode {OTAA, ABP};
 #endif  // USE_SERIAL || USE_DISPLAY
 
 
+uint16_t crc16(const void* data, uint16_t length, uint16_t crc = 0xFFFF)
+{
+    // CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+    // Pass the result of a previous call as crc to continue over multiple blocks.
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (length--)
+    {
+        crc ^= (uint16_t)(*bytes++) << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+
+uint8_t maxPayloadLength(dr_t dataRate)
+{
+    // Returns the max application payload length (bytes) for dataRate,
+    // per LoRaWAN Regional Parameters (without FOpts, dwell time limits off).
+    #if defined(CFG_us915)
+        static const uint8_t maxLength[] = { 11, 53, 125, 242, 242 };           // DR0-4
+    #elif defined(CFG_au915)
+        static const uint8_t maxLength[] = { 51, 51, 51, 115, 222, 222, 222 };  // DR0-6
+    #else
+        // EU868 and regions with a similar data rate table.
+        static const uint8_t maxLength[] = { 51, 51, 51, 115, 222, 222, 222, 222 };  // DR0-7
+    #endif
+    uint8_t length = dataRate < sizeof(maxLength) ? maxLength[dataRate] : maxLength[0];
+    return length < MAX_LEN_PAYLOAD ? length : static_cast<uint8_t>(MAX_LEN_PAYLOAD);
+}
+
+
+uint8_t maxUplinkPayloadLength()
+{
+    // Returns the max application payload length for the next uplink:
+    // the max for the current data rate minus MAC command responses
+    // that LMIC will piggyback in the frame header (FOpts).
+    uint8_t length = maxPayloadLength(LMIC.datarate);
+    #if defined(MCCI_LMIC) && defined(ARDUINO_LMIC_VERSION) && \
+        ARDUINO_LMIC_VERSION >= ARDUINO_LMIC_VERSION_CALC(4, 0, 0, 0)
+        if (LMIC.pendMacPiggyback && LMIC.pendMacLen < length)
+        {
+            length -= LMIC.pendMacLen;
+        }
+    #endif
+    return length;
+}
+
+
+bool timeCriticalJobsPending(uint16_t guardMs)
+{
+    // Returns true if LMIC has time critical work to do (e.g. open an 
+    // RX window) within guardMs milliseconds. Can be used to defer 
+    // non-essential work (e.g. output) so it will not disturb LMIC timing.
+    #ifdef MCCI_LMIC
+        return os_queryTimeCriticalJobs(os_getTime() + ms2osticks(guardMs));
+    #else
+        // Classic LMIC: be conservative, until TxRx has completed.
+        return (LMIC.opmode & OP_TXRXPEND) != 0;
+    #endif
+}
+
+
 #ifdef USE_DISPLAY 
     uint8_t transmitSymbol[8] = {0x18, 0x18, 0x00, 0x24, 0x99, 0x42, 0x3c, 0x00}; 
     #define ROW_0             0
@@ -264,6 +458,7 @@ enum class ActivationMode {OTAA, ABP};
     #define HEADER_ROW        ROW_0
     #define DEVICEID_ROW      ROW_1
     #define INTERVAL_ROW      ROW_2
+    #define AIRTIME_ROW       ROW_3       // USE_AIRTIME only
     #define TIME_ROW          ROW_4
     #define EVENT_ROW         ROW_5
     #define STATUS_ROW        ROW_6
@@ -273,21 +468,247 @@ enum class ActivationMode {OTAA, ABP};
     #define CLMICSYMBOL_COL   14
     #define TXSYMBOL_COL      15
 
+    #define DISPLAY_COLS      16
+    #define DISPLAY_ROWS      8
+    #define DISPLAY_TILE_BYTES 8    // Bytes transferred per 8x8 tile
+    #define DISPLAY_GRAPHIC_TILES 4   // Max different graphic tiles
+
+    #ifndef DISPLAY_UPDATE_INTERVAL_MS
+        #define DISPLAY_UPDATE_INTERVAL_MS 250    // Max 4 updates per second
+    #endif
+    #ifndef DISPLAY_GUARD_MS
+        #define DISPLAY_GUARD_MS 50               // Do not update if LMIC job due within
+    #endif
+
+    template<typename DisplayType>
+    class DisplayBuffer : public Print
+    {
+        // Keeps a shadow copy of the 16x8 character tile grid.
+        // Output is written to the shadow buffer only. update() compares
+        // it with what is currently on the panel and only transfers the 
+        // tiles that have changed, so clearing and rewriting a line with
+        // (mostly) the same text causes little or no I2C traffic.
+        // Graphic tiles (drawTile) are buffered as well, a reference to
+        // the tile data is kept (for up to DISPLAY_GRAPHIC_TILES different
+        // tiles) so the tile data must remain valid.
+
+    public:
+        DisplayBuffer(DisplayType& display) : display_(display)
+        {
+            memset(shadow_, ' ', sizeof(shadow_));
+            memset(panel_, ' ', sizeof(panel_));
+        }
+
+        size_t write(uint8_t ch) override
+        {
+            if (ch == '\n')
+            {
+                tx_ = 0;
+                ++ty_;
+            }
+            else if (ch != '\r')
+            {
+                setTile(tx_++, ty_, ch);
+            }
+            return 1;
+        }
+
+        using Print::write;
+
+        void clear()
+        {
+            memset(shadow_, ' ', sizeof(shadow_));
+            dirty_ = true;
+            tx_ = 0;
+            ty_ = 0;
+        }
+
+        void clearLine(uint8_t line)
+        {
+            if (line < DISPLAY_ROWS)
+            {
+                memset(shadow_[line], ' ', DISPLAY_COLS);
+                dirty_ = true;
+            }
+        }
+
+        void setCursor(uint8_t x, uint8_t y)
+        {
+            tx_ = x;
+            ty_ = y;
+        }
+
+        uint8_t drawGlyph(uint8_t x, uint8_t y, uint8_t encoding)
+        {
+            setTile(x, y, encoding);
+            return 1;
+        }
+
+        uint8_t drawString(uint8_t x, uint8_t y, const char* s)
+        {
+            uint8_t count = 0;
+            while (*s != '\0')
+            {
+                setTile(x++, y, *s++);
+                ++count;
+            }
+            return count;
+        }
+
+        void drawTile(uint8_t x, uint8_t y, uint8_t cnt, uint8_t* tile_ptr)
+        {
+            for (uint8_t i = 0; i < cnt; ++i)
+            {
+                uint8_t* tile = tile_ptr + i * DISPLAY_TILE_BYTES;
+                uint8_t index = 0;
+                while (index < graphicCount_ && graphicTiles_[index] != tile)
+                {
+                    ++index;
+                }
+                if (index == graphicCount_)
+                {
+                    if (graphicCount_ == DISPLAY_GRAPHIC_TILES)
+                    {
+                        // No room for another tile, write it to the panel directly.
+                        display_.drawTile(x + i, y, 1, tile);
+                        bytesSent_ += DISPLAY_TILE_BYTES;
+                        if (x + i < DISPLAY_COLS && y < DISPLAY_ROWS)
+                        {
+                            shadow_[y][x + i] = panel_[y][x + i] = UnknownTile;
+                        }
+                        continue;
+                    }
+                    graphicTiles_[graphicCount_++] = tile;
+                }
+                setTile(x + i, y, GraphicTile + index);
+            }
+        }
+
+        uint16_t update()
+        {
+            // Transfers changed tiles to the display. Adjacent changed 
+            // tiles on a row are transferred with a single call.
+            // Returns the number of bytes transferred.
+            if (!dirty_)
+            {
+                return 0;
+            }
+            uint16_t bytes = 0;
+            char run[DISPLAY_COLS + 1];
+            for (uint8_t row = 0; row < DISPLAY_ROWS; ++row)
+            {
+                uint8_t col = 0;
+                while (col < DISPLAY_COLS)
+                {
+                    if (shadow_[row][col] == panel_[row][col])
+                    {
+                        ++col;
+                        continue;
+                    }
+                    if (isGraphic(shadow_[row][col]))
+                    {
+                        display_.drawTile(col, row, 1, graphicTiles_[shadow_[row][col] - GraphicTile]);
+                        panel_[row][col] = shadow_[row][col];
+                        bytes += DISPLAY_TILE_BYTES;
+                        ++col;
+                        continue;
+                    }
+                    uint8_t start = col;
+                    uint8_t length = 0;
+                    while (col < DISPLAY_COLS && shadow_[row][col] != panel_[row][col]
+                           && !isGraphic(shadow_[row][col]))
+                    {
+                        run[length++] = shadow_[row][col];
+                        panel_[row][col] = shadow_[row][col];
+                        ++col;
+                    }
+                    run[length] = '\0';
+                    display_.drawString(start, row, run);
+                    bytes += length * DISPLAY_TILE_BYTES;
+                }
+            }
+            dirty_ = false;
+            lastUpdateBytes_ = bytes;
+            bytesSent_ += bytes;
+            return bytes;
+        }
+
+        bool dirty() const { return dirty_; }
+        uint16_t lastUpdateBytes() const { return lastUpdateBytes_; }
+        uint32_t bytesSent() const { return bytesSent_; }
+
+    private:
+        // Tile values below 0x20 are not used for text.
+        static const char UnknownTile = 0x01;    // Written directly, content not known
+        static const char GraphicTile = 0x02;    // Index 0 in graphicTiles_
+
+        static bool isGraphic(char ch) 
+        { 
+            return ch >= GraphicTile && ch < GraphicTile + DISPLAY_GRAPHIC_TILES; 
+        }
+
+        void setTile(uint8_t x, uint8_t y, char ch)
+        {
+            if (x < DISPLAY_COLS && y < DISPLAY_ROWS && shadow_[y][x] != ch)
+            {
+                shadow_[y][x] = ch;
+                dirty_ = true;
+            }
+        }
+
+        DisplayType& display_;
+        char shadow_[DISPLAY_ROWS][DISPLAY_COLS];    // Content to be displayed
+        char panel_[DISPLAY_ROWS][DISPLAY_COLS];     // Content currently on the panel
+        uint8_t* graphicTiles_[DISPLAY_GRAPHIC_TILES];
+        uint8_t graphicCount_ = 0;
+        uint8_t tx_ = 0;
+        uint8_t ty_ = 0;
+        bool dirty_ = false;
+        uint16_t lastUpdateBytes_ = 0;
+        uint32_t bytesSent_ = 0;
+    };
+
+    // All display output goes through the buffer, so printing from LMIC
+    // event handlers never performs I2C transfers.
+    DisplayBuffer<decltype(display)> screen(display);
+
     void initDisplay()
     {
         display.begin();
         display.setFont(u8x8_font_victoriamedium8_r); 
     }
 
+    void updateDisplay(bool force = false)
+    {
+        // Transfers changed content to the display.
+        // Unless forced, the display is updated at most once per 
+        // DISPLAY_UPDATE_INTERVAL_MS and not when an RX window (or other 
+        // LMIC job) is due within DISPLAY_GUARD_MS, so that I2C transfers
+        // do not disturb LMIC timing. A forced update is done immediately
+        // (used in setup and before blocking waits).
+        static uint32_t lastUpdateMs = 0;
+        if (!screen.dirty())
+        {
+            return;
+        }
+        uint32_t now = millis();
+        if (force || (now - lastUpdateMs >= DISPLAY_UPDATE_INTERVAL_MS 
+                      && !timeCriticalJobsPending(DISPLAY_GUARD_MS)))
+        {
+            screen.update();
+            lastUpdateMs = now;
+        }
+    }
+
     void displayTxSymbol(bool visible = true)
     {
         if (visible)
         {
-            display.drawTile(TXSYMBOL_COL, ROW_0, 1, transmitSymbol);
+            screen.drawTile(TXSYMBOL_COL, ROW_0, 1, transmitSymbol);
         }
         else
         {
-            display.drawGlyph(TXSYMBOL_COL, ROW_0, char(0x20));
+            screen.drawGlyph(TXSYMBOL_COL, ROW_0, char(0x20));
         }
     }    
 #endif // USE_DISPLAY
@@ -313,10 +734,11 @@ enum class ActivationMode {OTAA, ABP};
                 bool indefinite = (timeoutSeconds < 0);
                 uint16_t secondsLeft = timeoutSeconds; 
                 #ifdef USE_DISPLAY
-                    display.setCursor(0, ROW_1);
-                    display.print(F("Waiting for"));
-                    display.setCursor(0,  ROW_2);                
-                    display.print(F("serial port"));
+                    screen.setCursor(0, ROW_1);
+                    screen.print(F("Waiting for"));
+                    screen.setCursor(0,  ROW_2);                
+                    screen.print(F("serial port"));
+                    updateDisplay(true);
                 #endif
 
                 while (!serial && (indefinite || secondsLeft > 0))
@@ -324,26 +746,28 @@ enum class ActivationMode {OTAA, ABP};
                     if (!indefinite)
                     {
                         #ifdef USE_DISPLAY
-                            display.clearLine(ROW_4);
-                            display.setCursor(0, ROW_4);
-                            display.print(F("timeout in "));
-                            display.print(secondsLeft);
-                            display.print('s');
+                            screen.clearLine(ROW_4);
+                            screen.setCursor(0, ROW_4);
+                            screen.print(F("timeout in "));
+                            screen.print(secondsLeft);
+                            screen.print('s');
+                            updateDisplay(true);
                         #endif
                         --secondsLeft;
                     }
                     delay(1000);
                 }  
                 #ifdef USE_DISPLAY
-                    display.setCursor(0, ROW_4);
+                    screen.setCursor(0, ROW_4);
                     if (serial)
                     {
-                        display.print(F("Connected"));
+                        screen.print(F("Connected"));
                     }
                     else
                     {
-                        display.print(F("NOT connected"));
+                        screen.print(F("NOT connected"));
                     }
+                    updateDisplay(true);
                 #endif
             }
         #endif
@@ -353,4 +777,1950 @@ enum class ActivationMode {OTAA, ABP};
 #endif
 
 
+#ifdef USE_SERIAL
+    #ifdef USE_SERIAL_LOG_BUFFER
+
+        #ifndef SERIAL_LOG_BUFFER_SIZE
+            #define SERIAL_LOG_BUFFER_SIZE 512    // Bytes
+        #endif
+        #ifndef SERIAL_LOG_GUARD_MS
+            #define SERIAL_LOG_GUARD_MS 20        // Do not drain if LMIC job due within
+        #endif
+
+        template<typename SerialType>
+        class SerialLogBuffer : public Print
+        {
+            // Buffers serial output in a RAM ring buffer instead of writing
+            // it directly to the serial port, so that printing from LMIC
+            // event callbacks never blocks and does not disturb LMIC timing.
+            // The buffer is drained from loop() with drain(), which only 
+            // writes what fits in the serial transmit buffer.
+            // When the ring buffer is full, further output is dropped and
+            // counted. A note with the number of dropped bytes is added 
+            // to the output when the buffer has been drained.
+
+        public:
+            SerialLogBuffer(SerialType& port) : port_(port) {}
+
+            size_t write(uint8_t ch) override
+            {
+                if (count_ == SERIAL_LOG_BUFFER_SIZE)
+                {
+                    if (!overflowing_)
+                    {
+                        overflowing_ = true;
+                        ++overflowCount_;
+                    }
+                    ++droppedBytes_;
+                    return 0;
+                }
+                buffer_[head_] = ch;
+                head_ = (head_ + 1) % SERIAL_LOG_BUFFER_SIZE;
+                if (++count_ > highWaterMark_)
+                {
+                    highWaterMark_ = count_;
+                }
+                return 1;
+            }
+
+            using Print::write;
+
+            void drain()
+            {
+                // Writes buffered output to the serial port without blocking.
+                int room = port_.availableForWrite();
+                while (room > 0 && count_ > 0)
+                {
+                    port_.write(buffer_[tail_]);
+                    tail_ = (tail_ + 1) % SERIAL_LOG_BUFFER_SIZE;
+                    --count_;
+                    --room;
+                }
+                if (count_ == 0 && overflowing_)
+                {
+                    overflowing_ = false;
+                    print(F("[Serial log overflow: "));
+                    print(droppedBytes_ - reportedDroppedBytes_);
+                    println(F(" bytes dropped]"));
+                    reportedDroppedBytes_ = droppedBytes_;
+                }
+            }
+
+            void flush()
+            {
+                // Writes all buffered output to the serial port (blocking).
+                while (count_ > 0 || overflowing_)
+                {
+                    drain();
+                }
+                port_.flush();
+            }
+
+            uint16_t pending() const { return count_; }
+            uint16_t highWaterMark() const { return highWaterMark_; }
+            uint16_t overflowCount() const { return overflowCount_; }
+            uint32_t droppedBytes() const { return droppedBytes_; }
+
+        private:
+            SerialType& port_;
+            uint8_t buffer_[SERIAL_LOG_BUFFER_SIZE];
+            uint16_t head_ = 0;
+            uint16_t tail_ = 0;
+            uint16_t count_ = 0;
+            uint16_t highWaterMark_ = 0;
+            uint16_t overflowCount_ = 0;
+            uint32_t droppedBytes_ = 0;
+            uint32_t reportedDroppedBytes_ = 0;
+            bool overflowing_ = false;
+        };
+
+        SerialLogBuffer<decltype(serial)> serialLog(serial);
+
+    #else
+        // Unbuffered: output is written directly to the serial port.
+        auto& serialLog = serial;
+    #endif
+#endif
+
+
+#ifdef USE_BINARY_LOG
+    #ifndef USE_SERIAL
+        #error USE_BINARY_LOG requires USE_SERIAL.
+    #endif
+
+    // Binary log record codes.
+    // Codes below 0x80 are LMIC events (ev_t values).
+    // Codes 0xC0 and up are free for use in user code.
+    enum class LogCode : uint8_t
+    {
+        DoWorkStarted      = 0x80,
+        UplinkQueued       = 0x81,    // fPort and length of the uplink
+        UplinkNotScheduled = 0x82,
+        UplinkError        = 0x83,    // status is the (negated) LMIC error
+        Downlink           = 0x84,    // RSSI, SNR, fPort and length of the downlink
+        SessionRestored    = 0x85,
+        UplinkDropped      = 0x86,    // Uplink queue full (fPort and length of the new uplink) or
+                                      // queued uplink not sent, status is the failed attempts
+        UplinkExpired      = 0x87,    // status is the number of expired queued uplinks
+        IntervalChanged    = 0x88,    // doWork interval changed (downlink command)
+        Airtime            = 0x89,    // rssi is time-on-air (ms), snr is 24 hour total (s), length is band
+        NoChange           = 0x8A,    // Uplink skipped, data within deadbands (USE_REPORT_ON_CHANGE)
+        NotAcknowledged    = 0x8B,    // Confirmed uplink not acknowledged, status is retry number (0 = no retry)
+        DataRateChanged    = 0x8C,    // status is the data rate, length the TX power (dBm), rssi the link margin (dB, -1 = no answer)
+        JoinBackoff        = 0x8D,    // status is the data rate of the next attempt, rssi the backoff (s, max 32767)
+        JoinReport         = 0x8E,    // Joined, length is the attempts (max 255), status the data rate, rssi the latency (s, max 32767)
+        SubBandChanged     = 0x8F,    // status is the sub-band used for the next join attempts
+        SampleDropped      = 0x90,    // Sample batch full, oldest sample overwritten, rssi is the total (max 32767)
+        User               = 0xC0
+    };
+
+    #define LOG_RECORD_SYNC 0xA5
+    #define LOG_RECORD_SIZE 19
+
+    void logRecord(ostime_t timestamp, uint8_t code,
+                   uint8_t fPort = 0, uint8_t length = 0, uint8_t status = 0,
+                   int16_t rssi = 0, int16_t snrTenfold = 0)
+    {
+        // Writes a fixed size binary log record to the serial port.
+        // Multi-byte values are little endian. Layout:
+        //    0  sync (0xA5)           1  code
+        //    2  timestamp (4 bytes)   6  seqnoUp (2 bytes)   8  seqnoDn (2 bytes)
+        //   10  RSSI (dBm, 2 bytes)  12  SNR (0.1 dB, 2 bytes)
+        //   14  fPort                15  length              16  status
+        //   17  CRC-16 over bytes 1-16 (2 bytes)
+        // tools/decode-binary-log.py converts records back to text.
+        uint8_t record[LOG_RECORD_SIZE];
+        uint32_t time = (uint32_t)timestamp;
+        record[0] = LOG_RECORD_SYNC;
+        record[1] = code;
+        record[2] = time & 0xFF;
+        record[3] = (time >> 8) & 0xFF;
+        record[4] = (time >> 16) & 0xFF;
+        record[5] = time >> 24;
+        record[6] = LMIC.seqnoUp & 0xFF;
+        record[7] = (LMIC.seqnoUp >> 8) & 0xFF;
+        record[8] = LMIC.seqnoDn & 0xFF;
+        record[9] = (LMIC.seqnoDn >> 8) & 0xFF;
+        record[10] = (uint16_t)rssi & 0xFF;
+        record[11] = (uint16_t)rssi >> 8;
+        record[12] = (uint16_t)snrTenfold & 0xFF;
+        record[13] = (uint16_t)snrTenfold >> 8;
+        record[14] = fPort;
+        record[15] = length;
+        record[16] = status;
+        uint16_t crc = crc16(record + 1, LOG_RECORD_SIZE - 3);
+        record[17] = crc & 0xFF;
+        record[18] = crc >> 8;
+        serialLog.write(record, LOG_RECORD_SIZE);
+    }
+
+    void logRecord(ostime_t timestamp, LogCode code,
+                   uint8_t fPort = 0, uint8_t length = 0, uint8_t status = 0)
+    {
+        logRecord(timestamp, static_cast<uint8_t>(code), fPort, length, status);
+    }
+#endif
+
+
+// Downlink commands: a downlink frame contains one or more commands,
+// each encoded as opcode (1 byte), value length (1 byte) and value.
+// The length byte of the last command in a frame may be omitted if its 
+// value is empty, so single byte commands (e.g. 0xC0) remain valid.
+
+typedef void (*DownlinkCommandHandler)(ostime_t timestamp, const uint8_t* value, uint8_t length);
+
+struct DownlinkCommand
+{
+    uint8_t fPort;
+    uint8_t opcode;
+    uint8_t minLength;                  // Value length (bytes), commands with
+    uint8_t maxLength;                  // a different length are ignored.
+    DownlinkCommandHandler handler;     // Value points into the received frame, 
+};                                      // only valid during the call.
+
+
+// Uplink payload encoder, derived at compile time from UPLINK_SCHEMA (uplink-schema.h).
+
+template<uint16_t Offset, uint8_t Bits>
+inline void packBits(uint8_t* buffer, uint32_t value)
+{
+    // With constant Offset and Bits the compiler reduces 
+    // writeBits() to a few shifts per byte.
+    writeBits(buffer, Offset, value, Bits);
+}
+
+template<typename T> inline int64_t schemaWiden(T value) { return (int64_t)value; }
+inline float schemaWiden(float value) { return value; }
+inline double schemaWiden(double value) { return value; }
+
+// Rounds and clamps a scaled value to minimum .. maximum. Integer math is
+// 64-bit, so 32-bit unsigned values are not truncated. Floating point values
+// are clamped before the conversion (which is undefined when out of range).
+template<typename T> inline int64_t schemaRound(T value, int64_t minimum, int64_t maximum) 
+{ 
+    return value < minimum ? minimum : value > maximum ? maximum : (int64_t)value; 
+}
+inline int64_t schemaRound(float value, int64_t minimum, int64_t maximum)
+{
+    value = value < 0 ? value - 0.5f : value + 0.5f;
+    return value <= (float)minimum ? minimum : value >= (float)maximum ? maximum : (int64_t)value;
+}
+inline int64_t schemaRound(double value, int64_t minimum, int64_t maximum)
+{
+    value = value < 0 ? value - 0.5 : value + 0.5;
+    return value <= (double)minimum ? minimum : value >= (double)maximum ? maximum : (int64_t)value;
+}
+
+template<typename T, uint8_t Bits, typename S, typename O>
+inline uint32_t schemaRaw(T value, S scale, O offset)
+{
+    // Returns (value - offset) * scale, rounded and clamped to the range of the field.
+    // Integer math is used unless value, scale or offset is floating point.
+    static_assert(Bits >= 1 && Bits <= 32, "Schema field bits must be 1-32.");
+    const bool isSigned = (T)-1 < (T)0;
+    const int64_t minimum = isSigned ? -((int64_t)1 << (Bits - 1)) : 0;
+    const int64_t maximum = isSigned ? ((int64_t)1 << (Bits - 1)) - 1 : ((int64_t)1 << Bits) - 1;
+    return (uint32_t)schemaRound((schemaWiden(value) - offset) * scale, minimum, maximum);
+}
+
+#define SCHEMA_MEMBER(name, type, bits, scale, offset) type name;
+#define SCHEMA_OFFSET(name, type, bits, scale, offset) name##Offset, name##Last = name##Offset + (bits) - 1,
+#define SCHEMA_ENCODE(name, type, bits, scale, offset) \
+    packBits<UplinkSchema::name##Offset, bits>(buffer, schemaRaw<type, bits>(data.name, scale, offset));
+
+struct UplinkData
+{
+    UPLINK_SCHEMA(SCHEMA_MEMBER)
+};
+
+struct UplinkSchema
+{
+    // Bit offset of each field and total number of bits.
+    enum : uint16_t { UPLINK_SCHEMA(SCHEMA_OFFSET) Bits };
+};
+
+const uint8_t uplinkPayloadLength = (UplinkSchema::Bits + 7) / 8;
+
+uint8_t encodeUplink(const UplinkData& data, uint8_t* buffer)
+{
+    // Encodes data into buffer (at least uplinkPayloadLength bytes).
+    // Returns the payload length.
+    memset(buffer, 0, uplinkPayloadLength);
+    UPLINK_SCHEMA(SCHEMA_ENCODE)
+    return uplinkPayloadLength;
+}
+
+
+#ifdef USE_REPORT_ON_CHANGE
+    #ifdef USE_SAMPLE_BATCH
+        #error USE_REPORT_ON_CHANGE cannot be combined with USE_SAMPLE_BATCH.
+    #endif
+    #ifndef REPORT_MIN_INTERVAL_SECONDS
+        #define REPORT_MIN_INTERVAL_SECONDS 0       // Min time between reports (0 = no limit)
+    #endif
+    #ifndef REPORT_MAX_SILENCE_SECONDS
+        #define REPORT_MAX_SILENCE_SECONDS 3600     // Report at least this often (0 = never)
+    #endif
+
+    // ostime_t overflows for intervals of 2^31 ticks or longer
+    // (65535 seconds at the default OSTICKS_PER_SEC of 32768).
+    static_assert(REPORT_MIN_INTERVAL_SECONDS <= 0x7FFFFFFF / OSTICKS_PER_SEC 
+                  && REPORT_MAX_SILENCE_SECONDS <= 0x7FFFFFFF / OSTICKS_PER_SEC,
+                  "REPORT_MIN_INTERVAL_SECONDS and REPORT_MAX_SILENCE_SECONDS must be less than 2^31 ticks (0x7FFFFFFF / OSTICKS_PER_SEC seconds).");
+
+    // Deadbands from UPLINK_DEADBANDS (uplink-schema.h), 
+    // looked up by field index in UplinkData.
+    #define SCHEMA_FIELD_INDEX(name, type, bits, scale, offset) name##Field,
+    #define DEADBAND_ENTRY(name, absolute, relative) { UplinkField::name##Field, absolute, relative },
+
+    struct UplinkField
+    {
+        enum : uint8_t { UPLINK_SCHEMA(SCHEMA_FIELD_INDEX) Count };
+    };
+
+    struct UplinkDeadband
+    {
+        uint8_t field;
+        float absolute;
+        float relative;                             // Percent of the last reported value
+    };
+
+    // The last entry (no field) allows UPLINK_DEADBANDS to be empty.
+    const UplinkDeadband uplinkDeadbands[] = { UPLINK_DEADBANDS(DEADBAND_ENTRY) { UplinkField::Count, 0, 0 } };
+
+    template<typename T, uint8_t Bits, typename S, typename O>
+    bool fieldChanged(uint8_t field, T value, T last, S scale, O offset)
+    {
+        // Returns true if the change of a field from its last reported value
+        // is outside its deadband. Changes that are not visible in the sent
+        // value (after scaling and rounding) are never reported.
+        if (schemaRaw<T, Bits>(value, scale, offset) == schemaRaw<T, Bits>(last, scale, offset))
+        {
+            return false;
+        }
+        for (const UplinkDeadband& deadband : uplinkDeadbands)
+        {
+            if (deadband.field == field)
+            {
+                float previous = schemaWiden(last);
+                float change = schemaWiden(value) - previous;
+                change = change < 0 ? -change : change;
+                previous = previous < 0 ? -previous : previous;
+                return (deadband.absolute > 0 && change >= deadband.absolute)
+                       || (deadband.relative > 0 && change * 100 >= deadband.relative * previous);
+            }
+        }
+        return true;
+    }
+
+    #define SCHEMA_CHANGED(name, type, bits, scale, offset) \
+        changed = changed || fieldChanged<type, bits>(UplinkField::name##Field, data.name, last.name, scale, offset);
+
+    class ReportPolicy
+    {
+        // Send-on-change reporting: decides if sampled data is worth an uplink.
+        // Data is reported when a field changed outside its deadband,
+        // but not sooner than REPORT_MIN_INTERVAL_SECONDS after the last report
+        // (rate limit). If nothing changed, data is reported anyway after 
+        // REPORT_MAX_SILENCE_SECONDS (heartbeat), so the application
+        // can tell that the node is still alive.
+        // Timestamps are doWork job timestamps, which are at least a doWork
+        // interval apart, so a heartbeat that is a multiple of the interval is on time.
+
+    public:
+        bool due(const UplinkData& data, ostime_t timestamp) const
+        {
+            if (!reported_)
+            {
+                return true;
+            }
+            ostime_t elapsed = timestamp - lastReport_;
+            if (elapsed < sec2osticks(REPORT_MIN_INTERVAL_SECONDS))
+            {
+                return false;
+            }
+            if (REPORT_MAX_SILENCE_SECONDS != 0 && elapsed >= sec2osticks(REPORT_MAX_SILENCE_SECONDS))
+            {
+                return true;
+            }
+            return changed(data, last_);
+        }
+
+        void reported(const UplinkData& data, ostime_t timestamp)
+        {
+            // Call when data was scheduled or queued for transmission.
+            last_ = data;
+            lastReport_ = timestamp;
+            reported_ = true;
+        }
+
+    private:
+        static bool changed(const UplinkData& data, const UplinkData& last)
+        {
+            bool changed = false;
+            UPLINK_SCHEMA(SCHEMA_CHANGED)
+            return changed;
+        }
+
+        UplinkData last_;
+        ostime_t lastReport_ = 0;
+        bool reported_ = false;
+    };
+
+    ReportPolicy reportPolicy;
+#endif
+
+
+#ifdef USE_SAMPLE_BATCH
+    #ifndef SAMPLE_BATCH_SIZE
+        #ifdef SAMPLE_BATCH_COMPRESS
+            #define SAMPLE_BATCH_SIZE 32        // Samples per uplink
+        #else
+            #define SAMPLE_BATCH_SIZE 8         // Samples per uplink
+        #endif
+    #endif
+    #ifndef SAMPLE_BATCH_SAMPLE_BITS
+        #define SAMPLE_BATCH_SAMPLE_BITS 16     // Bits per sample (8-16)
+    #endif
+    #define SAMPLE_BATCH_HEADER_LENGTH 2        // Sample interval (seconds)
+    #ifdef SAMPLE_BATCH_COMPRESS
+        // Compressed samples take 1-3 bytes. If they do not fit,
+        // the remaining samples are sent in the next uplink.
+        #define SAMPLE_BATCH_PAYLOAD_LENGTH \
+            (SAMPLE_BATCH_HEADER_LENGTH + SAMPLE_BATCH_SIZE * 2 < 242 ? \
+             SAMPLE_BATCH_HEADER_LENGTH + SAMPLE_BATCH_SIZE * 2 : 242)
+    #else
+        #define SAMPLE_BATCH_PAYLOAD_LENGTH \
+            (SAMPLE_BATCH_HEADER_LENGTH + (SAMPLE_BATCH_SIZE * SAMPLE_BATCH_SAMPLE_BITS + 7) / 8)
+    #endif
+
+    static_assert(SAMPLE_BATCH_SAMPLE_BITS >= 8 && SAMPLE_BATCH_SAMPLE_BITS <= 16,
+                  "SAMPLE_BATCH_SAMPLE_BITS must be 8-16.");
+
+    class SampleBatch
+    {
+        // Ring buffer for samples that are sent together in one uplink.
+        // When more samples are added than fit, the oldest are overwritten.
+
+    public:
+        bool add(uint16_t sample)
+        {
+            // Returns false if the oldest sample was overwritten.
+            samples_[head_] = sample;
+            head_ = (head_ + 1) % SAMPLE_BATCH_SIZE;
+            if (count_ < SAMPLE_BATCH_SIZE)
+            {
+                ++count_;
+                return true;
+            }
+            ++overwritten_;
+            return false;
+        }
+
+        uint8_t pack(BitWriter& writer, uint8_t maxSamples) const
+        {
+            // Writes the oldest samples (max maxSamples), oldest first,
+            // as SAMPLE_BATCH_SAMPLE_BITS bit values. Values that do not fit
+            // are clamped. Returns the number of samples written.
+            const uint16_t maximum = (1UL << SAMPLE_BATCH_SAMPLE_BITS) - 1;
+            uint8_t count = count_ < maxSamples ? count_ : maxSamples;
+            uint8_t index = (head_ + SAMPLE_BATCH_SIZE - count_) % SAMPLE_BATCH_SIZE;
+            for (uint8_t i = 0; i < count; ++i)
+            {
+                uint16_t sample = samples_[index] < maximum ? samples_[index] : maximum;
+                writer.write(sample, SAMPLE_BATCH_SAMPLE_BITS);
+                index = (index + 1) % SAMPLE_BATCH_SIZE;
+            }
+            return count;
+        }
+
+        uint8_t compress(DeltaCompressor& compressor) const
+        {
+            // Adds the samples, oldest first, to compressor until it is full.
+            // Returns the number of samples added.
+            uint8_t index = (head_ + SAMPLE_BATCH_SIZE - count_) % SAMPLE_BATCH_SIZE;
+            uint8_t count = 0;
+            while (count < count_ && compressor.add(samples_[index]))
+            {
+                index = (index + 1) % SAMPLE_BATCH_SIZE;
+                ++count;
+            }
+            return count;
+        }
+
+        uint16_t compressedLength() const
+        {
+            // Returns the number of bytes needed to compress all samples.
+            uint8_t index = (head_ + SAMPLE_BATCH_SIZE - count_) % SAMPLE_BATCH_SIZE;
+            uint16_t length = 0;
+            int32_t previous = 0;
+            for (uint8_t i = 0; i < count_; ++i)
+            {
+                length += DeltaCompressor::encodedLength(samples_[index], previous);
+                previous = samples_[index];
+                index = (index + 1) % SAMPLE_BATCH_SIZE;
+            }
+            return length;
+        }
+
+        void remove(uint8_t count) 
+        { 
+            // Removes the oldest count samples.
+            count_ = count < count_ ? count_ - count : 0;
+        }
+
+        void clear() { count_ = 0; }
+        uint8_t count() const { return count_; }
+        uint32_t overwritten() const { return overwritten_; }
+
+    private:
+        uint16_t samples_[SAMPLE_BATCH_SIZE];
+        uint8_t head_ = 0;
+        uint8_t count_ = 0;
+        uint32_t overwritten_ = 0;
+    };
+
+    SampleBatch sampleBatch;
+#endif
+
+
+#ifdef USE_UPLINK_QUEUE
+    #ifndef UPLINK_QUEUE_SIZE
+        #define UPLINK_QUEUE_SIZE 4             // Number of messages
+    #endif
+    #ifndef UPLINK_QUEUE_PAYLOAD_SIZE
+        #ifdef USE_SAMPLE_BATCH
+            #define UPLINK_QUEUE_PAYLOAD_SIZE SAMPLE_BATCH_PAYLOAD_LENGTH
+        #else
+            #define UPLINK_QUEUE_PAYLOAD_SIZE 16    // Max payload length of a queued message
+        #endif
+    #endif
+    #ifndef UPLINK_QUEUE_MAX_ATTEMPTS
+        #define UPLINK_QUEUE_MAX_ATTEMPTS 3     // Drop a message that could not be scheduled this often
+    #endif
+
+    struct QueuedUplink
+    {
+        ostime_t queuedAt;
+        uint16_t maxAgeSeconds;                 // 0 is no max age, otherwise max 32767
+        uint8_t fPort;
+        uint8_t priority;                       // Higher priority is sent first
+        bool confirmed;
+        uint8_t attempts;                       // Failed attempts to schedule the message
+        uint8_t length;
+        uint8_t data[UPLINK_QUEUE_PAYLOAD_SIZE];
+    };
+
+    class UplinkQueue
+    {
+        // Bounded, statically allocated queue for uplink messages that 
+        // cannot be sent immediately (TxRx pending or waiting for duty cycle).
+        // Messages are sent highest priority first and in order of arrival
+        // for equal priority, so messages for the same fPort stay in order.
+        // When the queue is full the oldest message with the lowest priority
+        // is dropped, unless the new message has an even lower priority.
+
+    public:
+        bool push(ostime_t now, uint8_t fPort, const uint8_t* data, uint8_t length,
+                  uint8_t priority = 0, uint16_t maxAgeSeconds = 0, bool confirmed = false)
+        {
+            // Returns false if the new message was dropped. A queued message
+            // that makes room for the new one is counted in dropped() as well.
+            if (length > UPLINK_QUEUE_PAYLOAD_SIZE)
+            {
+                ++dropped_;
+                return false;
+            }
+            if (count_ == UPLINK_QUEUE_SIZE)
+            {
+                uint8_t lowest = 0;
+                for (uint8_t i = 1; i < count_; ++i)
+                {
+                    if (entries_[i].priority < entries_[lowest].priority)
+                    {
+                        lowest = i;
+                    }
+                }
+                ++dropped_;
+                if (priority < entries_[lowest].priority)
+                {
+                    return false;
+                }
+                remove(lowest);
+            }
+            QueuedUplink& entry = entries_[count_++];
+            entry.queuedAt = now;
+            entry.maxAgeSeconds = maxAgeSeconds;
+            entry.fPort = fPort;
+            entry.priority = priority;
+            entry.confirmed = confirmed;
+            entry.attempts = 0;
+            entry.length = length;
+            memcpy(entry.data, data, length);
+            if (count_ > highWaterMark_)
+            {
+                highWaterMark_ = count_;
+            }
+            return true;
+        }
+
+        uint8_t removeExpired(ostime_t now)
+        {
+            // Removes messages older than their max age.
+            // Returns the number of messages removed.
+            uint8_t removed = 0;
+            uint8_t i = 0;
+            while (i < count_)
+            {
+                const QueuedUplink& entry = entries_[i];
+                if (entry.maxAgeSeconds != 0 
+                    && now - entry.queuedAt > sec2osticks(entry.maxAgeSeconds))
+                {
+                    remove(i);
+                    ++removed;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            expired_ += removed;
+            return removed;
+        }
+
+        QueuedUplink* front()
+        {
+            // Returns the next message to send or nullptr if the queue is empty.
+            if (count_ == 0)
+            {
+                return nullptr;
+            }
+            uint8_t next = 0;
+            for (uint8_t i = 1; i < count_; ++i)
+            {
+                if (entries_[i].priority > entries_[next].priority)
+                {
+                    next = i;
+                }
+            }
+            return &entries_[next];
+        }
+
+        void pop()
+        {
+            // Removes the message returned by front().
+            QueuedUplink* next = front();
+            if (next != nullptr)
+            {
+                remove(next - entries_);
+            }
+        }
+
+        void drop()
+        {
+            // Removes the message returned by front() because it could not be sent.
+            if (front() != nullptr)
+            {
+                pop();
+                ++dropped_;
+            }
+        }
+
+        uint8_t count() const { return count_; }
+        uint8_t highWaterMark() const { return highWaterMark_; }
+        uint32_t dropped() const { return dropped_; }
+        uint32_t expired() const { return expired_; }
+
+    private:
+        void remove(uint8_t index)
+        {
+            // Keep remaining messages in order of arrival.
+            for (uint8_t i = index + 1; i < count_; ++i)
+            {
+                entries_[i - 1] = entries_[i];
+            }
+            --count_;
+        }
+
+        QueuedUplink entries_[UPLINK_QUEUE_SIZE];
+        uint8_t count_ = 0;
+        uint8_t highWaterMark_ = 0;
+        uint32_t dropped_ = 0;
+        uint32_t expired_ = 0;
+    };
+
+    UplinkQueue uplinkQueue;
+#endif
+
+
+#ifdef USE_FRAGMENTATION
+    #ifndef FRAGMENT_BUFFER_SIZE
+        #define FRAGMENT_BUFFER_SIZE 128        // Max length of a fragmented message
+    #endif
+    #ifndef FRAGMENT_FPORT
+        #define FRAGMENT_FPORT 13
+    #endif
+    #define FRAGMENT_HEADER_LENGTH 3            // fPort, message id, index (bit 7: last)
+    #define FRAGMENT_LAST 0x80
+
+    class UplinkFragmenter
+    {
+        // Splits a message that is too large for the current data rate 
+        // into fragments that are sent in consecutive uplinks on FRAGMENT_FPORT.
+        // Each fragment starts with a header: the message's own fPort, 
+        // a message id and the fragment index (bit 7 set for the last fragment).
+        // The fragment size is determined per fragment, so a data rate change
+        // (ADR) while a message is being sent is handled.
+        //
+        // The message is stored after room for one header. Each fragment's 
+        // header is written just before its data, over data that was already
+        // sent, so no separate transmit buffer is needed.
+
+    public:
+        bool start(uint8_t fPort, const uint8_t* data, uint8_t dataLength, bool confirmed, uint8_t messageId)
+        {
+            if (dataLength > FRAGMENT_BUFFER_SIZE || pending())
+            {
+                return false;
+            }
+            memcpy(buffer_ + FRAGMENT_HEADER_LENGTH, data, dataLength);
+            fPort_ = fPort;
+            length_ = dataLength;
+            offset_ = 0;
+            index_ = 0;
+            confirmed_ = confirmed;
+            messageId_ = messageId;
+            return true;
+        }
+
+        uint8_t* next(uint8_t maxLength, uint8_t& fragmentLength)
+        {
+            // Returns the next fragment of max maxLength bytes (including header),
+            // or nullptr if the frame has no room for data (e.g. when MAC command
+            // responses take most of a small frame).
+            if (maxLength <= FRAGMENT_HEADER_LENGTH)
+            {
+                return nullptr;
+            }
+            uint8_t remaining = length_ - offset_;
+            uint8_t size = maxLength - FRAGMENT_HEADER_LENGTH;
+            if (size > remaining)
+            {
+                size = remaining;
+            }
+            uint8_t* fragment = buffer_ + offset_;
+            offset_ += size;
+            fragment[0] = fPort_;
+            fragment[1] = messageId_;
+            fragment[2] = index_++ | (offset_ == length_ ? FRAGMENT_LAST : 0);
+            fragmentLength = FRAGMENT_HEADER_LENGTH + size;
+            return fragment;
+        }
+
+        bool owns(const uint8_t* data) const
+        {
+            return data >= buffer_ && data < buffer_ + sizeof(buffer_);
+        }
+
+        void cancel() { offset_ = length_; }
+        bool pending() const { return offset_ < length_; }
+        bool confirmed() const { return confirmed_; }
+
+    private:
+        uint8_t buffer_[FRAGMENT_HEADER_LENGTH + FRAGMENT_BUFFER_SIZE];
+        uint8_t fPort_ = 0;
+        uint8_t length_ = 0;
+        uint8_t offset_ = 0;
+        uint8_t index_ = 0;
+        uint8_t messageId_ = 0;
+        bool confirmed_ = false;
+    };
+
+    UplinkFragmenter uplinkFragmenter;
+#endif
+
+
+#if defined(USE_AIRTIME) || defined(USE_JOIN_SCHEDULE)
+    uint32_t timeOnAirUs(rps_t rps, uint8_t length)
+    {
+        // Returns the time-on-air in microseconds of a frame of length bytes
+        // (PHY payload) for spreading factor, bandwidth and coding rate in rps.
+        // Semtech LoRa modem designer's guide (AN1200.13): explicit header,
+        // CRC on, 8 preamble symbols. Low data rate optimization is used
+        // when a symbol takes 16 ms or longer. FSK: 50 kbps, 5 preamble, 
+        // 3 sync, 1 length and 2 CRC bytes.
+        uint8_t sf = getSf(rps);
+        if (sf == FSK)
+        {
+            return (5 + 3 + 1 + length + 2) * 8 * 20UL;
+        }
+        sf += 6;                                // SF7 is 1
+        uint16_t bandwidthKHz = 125 << getBw(rps);
+        uint32_t symbolUs = (1000UL << sf) / bandwidthKHz;
+        uint8_t lowDataRateOptimize = symbolUs >= 16000 ? 1 : 0;
+
+        int16_t numerator = 8 * length - 4 * sf + 28 + 16;
+        int16_t denominator = 4 * (sf - 2 * lowDataRateOptimize);
+        uint16_t payloadSymbols = 8;
+        if (numerator > 0)
+        {
+            payloadSymbols += ((numerator + denominator - 1) / denominator) * (getCr(rps) + 5);
+        }
+        // Preamble is 8 + 4.25 symbols.
+        return symbolUs * 49 / 4 + symbolUs * payloadSymbols;
+    }
+#endif
+
+
+#ifdef USE_AIRTIME
+    #ifndef MCCI_LMIC
+        #error USE_AIRTIME requires the MCCI LoRaWAN LMIC library.
+    #endif
+
+    #if CFG_LMIC_EU_like
+        #define AIRTIME_BANDS MAX_BANDS
+    #else
+        #define AIRTIME_BANDS 1                 // No duty cycle bands
+    #endif
+    #define AIRTIME_HOUR_MS 3600000UL
+
+    class AirtimeTracker
+    {
+        // Keeps the time-on-air of transmissions: per band since start,
+        // per band in the last hour (duty cycle) and the total in the last
+        // 24 hours (fair use). Rolling totals are kept in hourly buckets,
+        // time is taken from millis() which is advanced while sleeping.
+        // Must be called at least once every 49 days (millis() wraps).
+
+    public:
+        void add(uint8_t band, uint32_t airtimeUs)
+        {
+            advance();
+            if (band >= AIRTIME_BANDS)
+            {
+                band = 0;
+            }
+            lastUs_ = airtimeUs;
+            hourUs_[hour_] += airtimeUs;
+            bandHourUs_[band] += airtimeUs;
+            bandTotalUs_[band] += airtimeUs;
+        }
+
+        uint32_t lastUs() const { return lastUs_; }
+
+        uint32_t last24HoursMs()
+        {
+            // Airtime in the last 23 to 24 hours (the current hour is incomplete).
+            advance();
+            uint32_t totalMs = 0;
+            for (uint8_t i = 0; i < 24; ++i)
+            {
+                totalMs += hourUs_[i] / 1000;
+            }
+            return totalMs;
+        }
+
+        uint32_t bandLastHourMs(uint8_t band)
+        {
+            // Estimate for a rolling hour: the current hour plus the part of
+            // the previous hour that is still within the last 60 minutes.
+            advance();
+            if (band >= AIRTIME_BANDS)
+            {
+                return 0;
+            }
+            uint32_t elapsedMs = millis() - hourStartMs_;
+            uint64_t previousUs = (uint64_t)bandPreviousHourUs_[band] * (AIRTIME_HOUR_MS - elapsedMs) / AIRTIME_HOUR_MS;
+            return (bandHourUs_[band] + previousUs) / 1000;
+        }
+
+        uint32_t bandTotalMs(uint8_t band) const 
+        { 
+            return band < AIRTIME_BANDS ? bandTotalUs_[band] / 1000 : 0; 
+        }
+
+    private:
+        void advance()
+        {
+            // Moves to the current hour, clears the buckets of hours that have passed.
+            uint32_t hours = (millis() - hourStartMs_) / AIRTIME_HOUR_MS;
+            if (hours == 0)
+            {
+                return;
+            }
+            for (uint8_t band = 0; band < AIRTIME_BANDS; ++band)
+            {
+                bandPreviousHourUs_[band] = hours == 1 ? bandHourUs_[band] : 0;
+                bandHourUs_[band] = 0;
+            }
+            for (uint32_t i = 0; i < hours && i < 24; ++i)
+            {
+                hour_ = (hour_ + 1) % 24;
+                hourUs_[hour_] = 0;
+            }
+            hourStartMs_ += hours * AIRTIME_HOUR_MS;
+        }
+
+        uint32_t hourStartMs_ = 0;
+        uint8_t hour_ = 0;
+        uint32_t lastUs_ = 0;
+        uint32_t hourUs_[24] = {};
+        uint32_t bandHourUs_[AIRTIME_BANDS] = {};
+        uint32_t bandPreviousHourUs_[AIRTIME_BANDS] = {};
+        uint64_t bandTotalUs_[AIRTIME_BANDS] = {};
+    };
+
+    AirtimeTracker airtime;
+#endif
+
+
+#ifdef USE_AIRTIME_GOVERNOR
+    #ifndef USE_AIRTIME
+        #error USE_AIRTIME_GOVERNOR requires USE_AIRTIME.
+    #endif
+    #ifndef AIRTIME_BUDGET_SECONDS
+        #define AIRTIME_BUDGET_SECONDS 30       // Max uplink airtime per 24 hours (TTN fair use)
+    #endif
+
+    static_assert(AIRTIME_BUDGET_SECONDS > 0, "AIRTIME_BUDGET_SECONDS must be > 0.");
+
+    class AirtimeGovernor
+    {
+        // Determines the minimum time between uplinks that keeps the airtime
+        // within AIRTIME_BUDGET_SECONDS per 24 hours, for the current data rate
+        // and the length of the last uplink frame. If more than the budget
+        // was used in the last 24 hours (e.g. after the data rate was lowered)
+        // the interval is increased proportionally until usage is back within budget.
+
+    public:
+        void uplinkStarted(uint8_t frameLength)
+        {
+            // Called on EV_TXSTART of an uplink (not for join requests).
+            frameLength_ = frameLength;
+            lastUplinkMs_ = millis();
+            sent_ = true;
+        }
+
+        uint32_t uplinkIntervalSeconds()
+        {
+            // Returns 0 until the first uplink, the frame length is not known before.
+            if (!sent_)
+            {
+                return 0;
+            }
+            const uint32_t budgetMs = AIRTIME_BUDGET_SECONDS * 1000UL;
+            uint32_t airtimeUs = timeOnAirUs(updr2rps(LMIC.datarate), frameLength_);
+            uint64_t seconds = ((uint64_t)airtimeUs * 86400 + budgetMs * 1000ULL - 1) / (budgetMs * 1000ULL);
+            uint32_t usedMs = airtime.last24HoursMs();
+            if (usedMs > budgetMs)
+            {
+                seconds = seconds * usedMs / budgetMs;
+            }
+            // ostime_t overflows for intervals longer than 2^31 ticks.
+            const uint32_t maxSeconds = 0x7FFFFFFF / OSTICKS_PER_SEC;
+            return seconds < maxSeconds ? seconds : maxSeconds;
+        }
+
+        bool uplinkDue()
+        {
+            // Returns true if the next uplink can be sent within the budget.
+            return !sent_ || millis() - lastUplinkMs_ >= uplinkIntervalSeconds() * 1000;
+        }
+
+    private:
+        uint8_t frameLength_ = 0;
+        uint32_t lastUplinkMs_ = 0;
+        bool sent_ = false;
+    };
+
+    AirtimeGovernor airtimeGovernor;
+#endif
+
+
+#ifdef USE_LINK_QUALITY
+    #ifndef LINK_QUALITY_UPLINK_EVERY
+        #define LINK_QUALITY_UPLINK_EVERY 0         // Diagnostics uplink after every n uplinks (0 = none)
+    #endif
+    #ifndef LINK_QUALITY_FPORT
+        #define LINK_QUALITY_FPORT 14
+    #endif
+    #define LINK_QUALITY_BINS 8
+    #define LINK_QUALITY_RSSI_FIRST_BIN -130        // Lower edge of the first RSSI bin (dBm)
+    #define LINK_QUALITY_RSSI_BIN_WIDTH 10          // dB
+    #define LINK_QUALITY_SNR_FIRST_BIN -20          // Lower edge of the first SNR bin (dB)
+    #define LINK_QUALITY_SNR_BIN_WIDTH 5            // dB
+    #define LINK_QUALITY_EWMA_WEIGHT 8              // A new sample counts for 1/8 in the average
+    #define LINK_QUALITY_PAYLOAD_LENGTH 30
+
+    class LinkQualityTracker
+    {
+        // Keeps statistics of received downlinks in fixed memory: exponentially
+        // weighted moving average (EWMA), min and max and a histogram of RSSI and SNR,
+        // the number of downlinks missed (gaps in the downlink frame counter) 
+        // and the ACK success of the last 16 confirmed uplinks.
+        // Values below the first or above the last histogram bin are counted 
+        // in the first or last bin. Averages are kept with 8 fractional bits.
+        // SNR values are tenfold (0.1 dB).
+
+    public:
+        void addDownlink(int16_t rssi, int16_t snrTenfold, uint32_t seqnoDn)
+        {
+            if (downlinks_ == 0)
+            {
+                rssiAverage_ = (int32_t)rssi * 256;
+                snrAverage_ = (int32_t)snrTenfold * 256;
+                rssiMin_ = rssiMax_ = rssi;
+                snrMin_ = snrMax_ = snrTenfold;
+            }
+            else
+            {
+                rssiAverage_ += ((int32_t)rssi * 256 - rssiAverage_) / LINK_QUALITY_EWMA_WEIGHT;
+                snrAverage_ += ((int32_t)snrTenfold * 256 - snrAverage_) / LINK_QUALITY_EWMA_WEIGHT;
+                rssiMin_ = rssi < rssiMin_ ? rssi : rssiMin_;
+                rssiMax_ = rssi > rssiMax_ ? rssi : rssiMax_;
+                snrMin_ = snrTenfold < snrMin_ ? snrTenfold : snrMin_;
+                snrMax_ = snrTenfold > snrMax_ ? snrTenfold : snrMax_;
+                // A lower frame counter means a new session.
+                if (seqnoDn > lastSeqnoDn_ + 1)
+                {
+                    missed_ += seqnoDn - lastSeqnoDn_ - 1;
+                }
+            }
+            lastSeqnoDn_ = seqnoDn;
+            addToHistogram(rssiHistogram_, (rssi - LINK_QUALITY_RSSI_FIRST_BIN) / LINK_QUALITY_RSSI_BIN_WIDTH);
+            addToHistogram(snrHistogram_, 
+                           (snrTenfold - LINK_QUALITY_SNR_FIRST_BIN * 10) / (LINK_QUALITY_SNR_BIN_WIDTH * 10));
+            if (downlinks_ < 0xFFFF)
+            {
+                ++downlinks_;
+            }
+        }
+
+        void addAck(bool acknowledged)
+        {
+            ackHistory_ = (ackHistory_ << 1) | (acknowledged ? 1 : 0);
+            if (ackCount_ < 16)
+            {
+                ++ackCount_;
+            }
+        }
+
+        uint16_t downlinks() const { return downlinks_; }
+        uint16_t missedDownlinks() const { return missed_; }
+        int16_t rssiAverage() const { return roundAverage(rssiAverage_); }
+        int16_t snrTenfoldAverage() const { return roundAverage(snrAverage_); }
+        int16_t rssiMin() const { return rssiMin_; }
+        int16_t rssiMax() const { return rssiMax_; }
+        int16_t snrTenfoldMin() const { return snrMin_; }
+        int16_t snrTenfoldMax() const { return snrMax_; }
+        uint16_t rssiBin(uint8_t bin) const { return rssiHistogram_[bin]; }
+        uint16_t snrBin(uint8_t bin) const { return snrHistogram_[bin]; }
+
+        uint8_t ackPercent() const
+        {
+            // ACK success of recent confirmed uplinks, 255 if none were sent.
+            if (ackCount_ == 0)
+            {
+                return 255;
+            }
+            uint8_t acks = 0;
+            for (uint8_t i = 0; i < ackCount_; ++i)
+            {
+                acks += (ackHistory_ >> i) & 1;
+            }
+            return acks * 100 / ackCount_;
+        }
+
+        uint8_t encode(uint8_t* buffer, uint8_t size) const
+        {
+            // Diagnostics uplink payload (LINK_QUALITY_PAYLOAD_LENGTH bytes):
+            // RSSI average, min, max (dBm, 8 bits signed each), SNR average, min,
+            // max (0.1 dB, 16 bits signed each), ACK success (%, 255 = none),
+            // downlinks and missed downlinks (16 bits each), followed by the RSSI
+            // and SNR histograms (8 bins each, percent of downlinks per bin).
+            BitWriter writer(buffer, size);
+            writer.writeSigned(rssiAverage(), 8);
+            writer.writeSigned(rssiMin_, 8);
+            writer.writeSigned(rssiMax_, 8);
+            writer.writeSigned(snrTenfoldAverage(), 16);
+            writer.writeSigned(snrMin_, 16);
+            writer.writeSigned(snrMax_, 16);
+            writer.write(ackPercent(), 8);
+            writer.write(downlinks_, 16);
+            writer.write(missed_, 16);
+            writeHistogram(writer, rssiHistogram_);
+            writeHistogram(writer, snrHistogram_);
+            return writer.length();
+        }
+
+    private:
+        static int16_t roundAverage(int32_t average)
+        {
+            return (average < 0 ? average - 128 : average + 128) / 256;
+        }
+
+        static void addToHistogram(uint16_t* histogram, int16_t bin)
+        {
+            bin = bin < 0 ? 0 : bin >= LINK_QUALITY_BINS ? LINK_QUALITY_BINS - 1 : bin;
+            if (histogram[bin] < 0xFFFF)
+            {
+                ++histogram[bin];
+            }
+        }
+
+        void writeHistogram(BitWriter& writer, const uint16_t* histogram) const
+        {
+            for (uint8_t bin = 0; bin < LINK_QUALITY_BINS; ++bin)
+            {
+                writer.write(downlinks_ != 0 ? (uint32_t)histogram[bin] * 100 / downlinks_ : 0, 8);
+            }
+        }
+
+        int32_t rssiAverage_ = 0;
+        int32_t snrAverage_ = 0;
+        int16_t rssiMin_ = 0;
+        int16_t rssiMax_ = 0;
+        int16_t snrMin_ = 0;
+        int16_t snrMax_ = 0;
+        uint16_t rssiHistogram_[LINK_QUALITY_BINS] = {};
+        uint16_t snrHistogram_[LINK_QUALITY_BINS] = {};
+        uint16_t downlinks_ = 0;
+        uint16_t missed_ = 0;
+        uint32_t lastSeqnoDn_ = 0;
+        uint16_t ackHistory_ = 0;                   // Bit 0 is the most recent result
+        uint8_t ackCount_ = 0;
+    };
+
+    LinkQualityTracker linkQuality;
+#endif
+
+
+#ifdef USE_CONFIRM_POLICY
+    #ifndef CONFIRM_EVERY
+        #define CONFIRM_EVERY 10                    // Every nth uplink is confirmed (0 = none)
+    #endif
+    #ifndef CONFIRM_MAX_RETRIES
+        #define CONFIRM_MAX_RETRIES 1               // Max retries of an unacknowledged uplink
+    #endif
+    #ifndef CONFIRM_MAX_TRANSMISSIONS
+        #define CONFIRM_MAX_TRANSMISSIONS 16        // Max transmissions of an uplink, including LMIC's
+    #endif
+    #ifndef CONFIRM_RETRY_BACKOFF_SECONDS
+        #define CONFIRM_RETRY_BACKOFF_SECONDS 30    // Delay before the first retry, doubles per retry
+    #endif
+    #ifndef CONFIRM_BUFFER_SIZE
+        #define CONFIRM_BUFFER_SIZE 51              // Max payload length of a message that can be retried
+    #endif
+    #define CONFIRM_HISTORY 16                      // Number of recent confirmed uplinks for ACK success
+    #define CONFIRM_LMIC_ATTEMPTS 8                 // Transmissions of a confirmed uplink by LMIC (TXCONF_ATTEMPTS)
+
+    static_assert(CONFIRM_MAX_TRANSMISSIONS >= CONFIRM_LMIC_ATTEMPTS,
+                  "CONFIRM_MAX_TRANSMISSIONS must be at least 8, LMIC transmits a confirmed uplink up to 8 times.");
+
+    class ConfirmPolicy
+    {
+        // Decides which uplinks are sent confirmed: uplinks on critical fPorts
+        // (isCriticalFPort()) and every CONFIRM_EVERY uplink, which validates
+        // the link without a downlink for every uplink.
+        // Keeps track of the ACK success of the last CONFIRM_HISTORY confirmed 
+        // uplinks (with USE_LINK_QUALITY the ACK success kept by linkQuality 
+        // is used). An unacknowledged uplink is sent again, with exponential backoff.
+        // The number of retries and the backoff adapt to the ACK success: 
+        // when most uplinks are acknowledged a missed ACK is likely incidental
+        // and the uplink is retried up to CONFIRM_MAX_RETRIES times. When few
+        // are acknowledged, retries are unlikely to succeed and only waste 
+        // airtime, so fewer retries are made with a longer backoff.
+        // Note that LMIC itself also retransmits a confirmed uplink (with the 
+        // same frame counter) up to CONFIRM_LMIC_ATTEMPTS times before it reports
+        // it as not acknowledged. Retries are limited so that an uplink is not
+        // transmitted more than CONFIRM_MAX_TRANSMISSIONS times in total.
+
+    public:
+        bool confirm(uint8_t fPort, bool confirmed)
+        {
+            // Returns true if the uplink is to be sent confirmed.
+            ++uplinks_;
+            return confirmed || isCriticalFPort(fPort) || (CONFIRM_EVERY != 0 && uplinks_ % CONFIRM_EVERY == 0);
+        }
+
+        void sent(uint8_t fPort, const uint8_t* data, uint8_t length)
+        {
+            // Keeps a copy of a new confirmed uplink for retries.
+            if (data == data_)
+            {
+                return;
+            }
+            retries_ = 0;
+            pending_ = length <= CONFIRM_BUFFER_SIZE;
+            if (pending_)
+            {
+                memcpy(data_, data, length);
+                fPort_ = fPort;
+                length_ = length;
+            }
+        }
+
+        void result(bool acknowledged)
+        {
+            // With USE_LINK_QUALITY the ACK history is kept by linkQuality 
+            // (updateLinkQuality() on EV_TXCOMPLETE), not kept twice.
+            #ifndef USE_LINK_QUALITY
+                history_ = (history_ << 1) | (acknowledged ? 1 : 0);
+                if (count_ < CONFIRM_HISTORY)
+                {
+                    ++count_;
+                }
+            #endif
+            if (acknowledged)
+            {
+                pending_ = false;
+            }
+        }
+
+        uint8_t ackPercent() const
+        {
+            // ACK success of recent confirmed uplinks, 100 if none were sent yet.
+            #ifdef USE_LINK_QUALITY
+                uint8_t percent = linkQuality.ackPercent();
+                return percent <= 100 ? percent : 100;      // 255: none sent yet
+            #else
+                if (count_ == 0)
+                {
+                    return 100;
+                }
+                uint8_t acks = 0;
+                for (uint8_t i = 0; i < count_; ++i)
+                {
+                    acks += (history_ >> i) & 1;
+                }
+                return acks * 100 / count_;
+            #endif
+        }
+
+        bool retry(uint32_t& delaySeconds)
+        {
+            // Call after result(false) or when a retry could not be scheduled.
+            // Returns true if the uplink is to be sent again after delaySeconds.
+            uint8_t percent = ackPercent();
+            uint8_t maxRetries = (CONFIRM_MAX_RETRIES * percent + 50) / 100;
+            if (maxRetries > CONFIRM_MAX_TRANSMISSIONS / CONFIRM_LMIC_ATTEMPTS - 1)
+            {
+                maxRetries = CONFIRM_MAX_TRANSMISSIONS / CONFIRM_LMIC_ATTEMPTS - 1;
+            }
+            if (!pending_ || retries_ >= maxRetries)
+            {
+                pending_ = false;
+                return false;
+            }
+            delaySeconds = ((uint32_t)CONFIRM_RETRY_BACKOFF_SECONDS << retries_) * (200 - percent) / 100;
+            ++retries_;
+            return true;
+        }
+
+        uint8_t fPort() const { return fPort_; }
+        uint8_t* data() { return data_; }
+        uint8_t length() const { return length_; }
+        uint8_t retries() const { return retries_; }
+        bool pending() const { return pending_; }           // Waiting for ACK or retry
+
+    private:
+        uint8_t data_[CONFIRM_BUFFER_SIZE];
+        uint8_t fPort_ = 0;
+        uint8_t length_ = 0;
+        uint8_t retries_ = 0;
+        bool pending_ = false;
+        #ifndef USE_LINK_QUALITY
+            uint16_t history_ = 0;                  // Bit 0 is the most recent result
+            uint8_t count_ = 0;
+        #endif
+        uint32_t uplinks_ = 0;
+    };
+
+    ConfirmPolicy confirmPolicy;
+#endif
+
+
+#ifdef USE_MOBILE_DATA_RATE
+    #ifndef MCCI_LMIC
+        #error USE_MOBILE_DATA_RATE requires the MCCI LoRaWAN LMIC library.
+    #endif
+    #ifndef LINK_CHECK_EVERY
+        #define LINK_CHECK_EVERY 8                  // Send a LinkCheckReq with every nth uplink
+    #endif
+    #ifndef MOBILE_DR_MARGIN
+        #define MOBILE_DR_MARGIN 5                  // Link margin to keep (dB)
+    #endif
+    #ifndef MOBILE_DR_HYSTERESIS
+        #define MOBILE_DR_HYSTERESIS 3              // Extra margin required for a faster data rate (dB)
+    #endif
+    #ifndef MOBILE_DR_MAX_MISSES
+        #define MOBILE_DR_MAX_MISSES 2              // Unanswered link checks before stepping down
+    #endif
+    #ifndef MOBILE_DR_MIN_TX_POWER
+        #define MOBILE_DR_MIN_TX_POWER 2            // dBm
+    #endif
+    #ifndef MOBILE_DR_MAX_TX_POWER
+        #define MOBILE_DR_MAX_TX_POWER 14           // dBm
+    #endif
+    #if defined(CFG_us915)
+        #define MOBILE_DR_MIN DR_SF10               // Slowest uplink data rate of the region
+    #else
+        #define MOBILE_DR_MIN DR_SF12
+    #endif
+    #define MOBILE_DR_MAX DR_SF7
+    #define MOBILE_DR_STEP_TENFOLD 25               // Demodulation floor difference per SF step (0.1 dB)
+    #define MOBILE_DR_POWER_STEP 2                  // dB
+
+    class DataRateController
+    {
+        // Node side data rate control for mobile nodes, which should not use ADR.
+        // A LinkCheckReq is sent with every LINK_CHECK_EVERY uplink. The margin
+        // in the LinkCheckAns (how many dB the uplink was above the demodulation 
+        // floor of its data rate) determines the data rate and transmit power:
+        // below MOBILE_DR_MARGIN the transmit power is raised first and then the
+        // data rate is lowered (2.5 dB per step). With MOBILE_DR_HYSTERESIS more 
+        // margin than needed the data rate is raised and, at the fastest data rate,
+        // the transmit power is lowered. A node that is received by a single 
+        // gateway requires twice the hysteresis to step up.
+        // When link checks are not answered (e.g. out of range) a link check is 
+        // sent with every uplink, and after MOBILE_DR_MAX_MISSES unanswered link 
+        // checks the transmit power is set to maximum or the data rate is lowered.
+
+    public:
+        bool linkCheckDue()
+        {
+            // Called for each uplink.
+            uplinkCount_ = (uplinkCount_ + 1) % LINK_CHECK_EVERY;
+            return uplinkCount_ == 0 || misses_ != 0;
+        }
+
+        void linkCheckSent() { pending_ = true; }
+        bool pending() const { return pending_; }
+        uint8_t margin() const { return margin_; }
+        uint8_t gatewayCount() const { return gatewayCount_; }
+
+        bool answered(uint8_t margin, uint8_t gatewayCount, dr_t& dataRate, s1_t& txPower)
+        {
+            // Adjusts dataRate and txPower for the received link margin (dB).
+            // Returns true if either was changed.
+            pending_ = false;
+            misses_ = 0;
+            margin_ = margin;
+            gatewayCount_ = gatewayCount;
+            dr_t oldDataRate = dataRate;
+            s1_t oldTxPower = txPower;
+            int16_t excess = (int16_t)margin * 10 - MOBILE_DR_MARGIN * 10;
+            if (excess < 0)
+            {
+                while (excess < 0 && txPower + MOBILE_DR_POWER_STEP <= MOBILE_DR_MAX_TX_POWER)
+                {
+                    txPower += MOBILE_DR_POWER_STEP;
+                    excess += MOBILE_DR_POWER_STEP * 10;
+                }
+                while (excess < 0 && dataRate > MOBILE_DR_MIN)
+                {
+                    dataRate = (dr_t)(dataRate - 1);
+                    excess += MOBILE_DR_STEP_TENFOLD;
+                }
+            }
+            else
+            {
+                excess -= MOBILE_DR_HYSTERESIS * 10 * (gatewayCount > 1 ? 1 : 2);
+                while (excess >= MOBILE_DR_STEP_TENFOLD && dataRate < MOBILE_DR_MAX)
+                {
+                    dataRate = (dr_t)(dataRate + 1);
+                    excess -= MOBILE_DR_STEP_TENFOLD;
+                }
+                while (dataRate == MOBILE_DR_MAX && excess >= MOBILE_DR_POWER_STEP * 10 
+                       && txPower - MOBILE_DR_POWER_STEP >= MOBILE_DR_MIN_TX_POWER)
+                {
+                    txPower -= MOBILE_DR_POWER_STEP;
+                    excess -= MOBILE_DR_POWER_STEP * 10;
+                }
+            }
+            return dataRate != oldDataRate || txPower != oldTxPower;
+        }
+
+        bool missed(dr_t& dataRate, s1_t& txPower)
+        {
+            // Called when a link check was not answered.
+            // Returns true if dataRate or txPower was changed.
+            // Link checks are sent with every uplink until one is answered.
+            pending_ = false;
+            misses_ = misses_ < 0xFF ? misses_ + 1 : misses_;
+            if (misses_ % MOBILE_DR_MAX_MISSES != 0)
+            {
+                return false;
+            }
+            if (txPower < MOBILE_DR_MAX_TX_POWER)
+            {
+                txPower = MOBILE_DR_MAX_TX_POWER;
+                return true;
+            }
+            if (dataRate > MOBILE_DR_MIN)
+            {
+                dataRate = (dr_t)(dataRate - 1);
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        uint8_t uplinkCount_ = 0;
+        uint8_t misses_ = 0;
+        uint8_t margin_ = 0;
+        uint8_t gatewayCount_ = 0;
+        bool pending_ = false;
+    };
+
+    DataRateController dataRateController;
+#endif
+
+
+#ifdef USE_JOIN_SCHEDULE
+    #ifndef MCCI_LMIC
+        #error USE_JOIN_SCHEDULE requires the MCCI LoRaWAN LMIC library.
+    #endif
+    #ifndef OTAA_ACTIVATION
+        #error USE_JOIN_SCHEDULE requires OTAA activation.
+    #endif
+    #ifndef JOIN_DR_FIRST
+        #define JOIN_DR_FIRST DR_SF7                // Data rate of the first join attempts
+    #endif
+    #ifndef JOIN_DR_LAST
+        #if defined(CFG_us915)
+            #define JOIN_DR_LAST DR_SF10            // Slowest data rate, then start again from JOIN_DR_FIRST
+        #else
+            #define JOIN_DR_LAST DR_SF12
+        #endif
+    #endif
+    #ifndef JOIN_ATTEMPTS_PER_DR
+        #define JOIN_ATTEMPTS_PER_DR 2
+    #endif
+    #ifndef JOIN_START_JITTER_SECONDS
+        #define JOIN_START_JITTER_SECONDS 30        // Random delay (0 .. n seconds) before the first attempt
+    #endif
+    #ifndef JOIN_BACKOFF_SECONDS
+        #define JOIN_BACKOFF_SECONDS 15             // Random backoff (0 .. n seconds), doubles every round
+    #endif
+    #ifndef JOIN_BACKOFF_MAX_SECONDS
+        #define JOIN_BACKOFF_MAX_SECONDS 3600
+    #endif
+    #ifndef JOIN_REPORT_FPORT
+        #define JOIN_REPORT_FPORT 15
+    #endif
+    #define JOIN_REQUEST_LENGTH 23                  // PHY payload length of a join request
+    #define JOIN_REPORT_PAYLOAD_LENGTH 7
+
+    class JoinScheduler
+    {
+        // Decides the data rate of each OTAA join attempt and the backoff until 
+        // the next attempt. Attempts start at the fast JOIN_DR_FIRST, which uses
+        // little airtime, and step to slower data rates (JOIN_ATTEMPTS_PER_DR 
+        // attempts each) down to JOIN_DR_LAST. Then a new round starts at 
+        // JOIN_DR_FIRST. After each attempt the node waits at least the off-time
+        // of the join duty cycle (LoRaWAN 1.0.3 section 7: aggregated 1% in the
+        // first hour, 0.1% in the next 10 hours, 0.01% after that) plus a random 
+        // backoff of up to JOIN_BACKOFF_SECONDS that doubles every round (max 
+        // JOIN_BACKOFF_MAX_SECONDS), so nodes that start at the same time
+        // (e.g. after a power outage) do not keep colliding.
+        // Keeps the number of attempts and join latency for the join report.
+
+    public:
+        void start(uint32_t nowMs)
+        {
+            startMs_ = nowMs;
+            attempts_ = 0;
+            latencyMs_ = 0;
+            reportPending_ = false;
+        }
+
+        dr_t nextDataRate() const
+        {
+            uint8_t step = (attempts_ / JOIN_ATTEMPTS_PER_DR) % dataRateSteps();
+            return (dr_t)(JOIN_DR_FIRST - step);
+        }
+
+        void attemptStarted(dr_t dataRate)
+        {
+            dataRate_ = dataRate;
+            if (attempts_ < 0xFFFF)
+            {
+                ++attempts_;
+            }
+        }
+
+        uint32_t backoffMs(uint32_t nowMs, uint32_t random) const
+        {
+            // Time between the end of the last attempt and the next attempt.
+            uint32_t elapsedMs = nowMs - startMs_;
+            uint32_t offTimeFactor = elapsedMs < 3600000UL ? 99 : elapsedMs < 39600000UL ? 999 : 9999;
+            uint32_t offTimeMs = (uint64_t)timeOnAirUs(updr2rps(dataRate_), JOIN_REQUEST_LENGTH) 
+                                 * offTimeFactor / 1000;
+            uint16_t round = (attempts_ - 1) / (JOIN_ATTEMPTS_PER_DR * dataRateSteps());
+            uint32_t windowSeconds = JOIN_BACKOFF_SECONDS;
+            while (round-- > 0 && windowSeconds < JOIN_BACKOFF_MAX_SECONDS)
+            {
+                windowSeconds *= 2;
+            }
+            windowSeconds = windowSeconds < JOIN_BACKOFF_MAX_SECONDS ? windowSeconds : JOIN_BACKOFF_MAX_SECONDS;
+            return offTimeMs + random % (windowSeconds * 1000 + 1);
+        }
+
+        void joined(uint32_t nowMs)
+        {
+            latencyMs_ = nowMs - startMs_;
+            reportPending_ = true;
+        }
+
+        uint16_t attempts() const { return attempts_; }
+        uint32_t latencyMs() const { return latencyMs_; }
+        dr_t dataRate() const { return dataRate_; }
+        bool reportPending() const { return reportPending_; }
+        void reportSent() { reportPending_ = false; }
+
+        uint8_t encode(uint8_t* buffer, uint8_t size) const
+        {
+            // Join report payload (JOIN_REPORT_PAYLOAD_LENGTH bytes): join attempts 
+            // (16 bits), join latency in seconds (32 bits), data rate of the 
+            // successful attempt (8 bits).
+            BitWriter writer(buffer, size);
+            writer.write(attempts_, 16);
+            writer.write(latencyMs_ / 1000, 32);
+            writer.write(dataRate_, 8);
+            return writer.length();
+        }
+
+    private:
+        static uint8_t dataRateSteps() { return JOIN_DR_FIRST - JOIN_DR_LAST + 1; }
+
+        uint32_t startMs_ = 0;
+        uint32_t latencyMs_ = 0;
+        uint16_t attempts_ = 0;
+        dr_t dataRate_ = JOIN_DR_FIRST;
+        bool reportPending_ = false;
+    };
+
+    JoinScheduler joinScheduler;
+#endif
+
+
+#ifdef USE_SUBBAND_DISCOVERY
+    #if !defined(CFG_us915) && !defined(CFG_au915)
+        #error USE_SUBBAND_DISCOVERY requires the US915 or AU915 region.
+    #endif
+    #ifndef MCCI_LMIC
+        #error USE_SUBBAND_DISCOVERY requires the MCCI LoRaWAN LMIC library.
+    #endif
+    #ifndef OTAA_ACTIVATION
+        #error USE_SUBBAND_DISCOVERY requires OTAA activation.
+    #endif
+    #ifndef SUBBAND_JOIN_ATTEMPTS
+        #define SUBBAND_JOIN_ATTEMPTS 2             // Failed join attempts before the next sub-band is tried
+    #endif
+    #define SUBBAND_COUNT 8
+
+    class SubBandSelector
+    {
+        // Selects the sub-band (group of 8 channels) used for OTAA joins.
+        // Joining starts on the stored sub-band of the last successful join
+        // or else on SUBBAND. After SUBBAND_JOIN_ATTEMPTS failed attempts the
+        // next sub-band is tried, so a node finds the sub-band of its gateways
+        // within 8 * SUBBAND_JOIN_ATTEMPTS attempts.
+
+    public:
+        void begin(uint8_t storedSubBand)
+        {
+            // storedSubBand is the stored sub-band + 1, 0 if none.
+            if (storedSubBand > 0 && storedSubBand <= SUBBAND_COUNT)
+            {
+                subBand_ = storedSubBand - 1;
+            }
+        }
+
+        bool joinFailed()
+        {
+            // Returns true if the next sub-band must be used.
+            if (++failures_ < SUBBAND_JOIN_ATTEMPTS)
+            {
+                return false;
+            }
+            failures_ = 0;
+            subBand_ = (subBand_ + 1) % SUBBAND_COUNT;
+            return true;
+        }
+
+        void joined() { failures_ = 0; }
+        uint8_t subBand() const { return subBand_; }
+
+    private:
+        uint8_t subBand_ = SUBBAND;
+        uint8_t failures_ = 0;
+    };
+
+    SubBandSelector subBandSelector;
+#endif
+
+
+#ifdef STORAGE_SIZE
+    // Settings that can be changed at runtime (e.g. with a downlink command)
+    // are stored in the last SETTINGS_STORAGE_SIZE bytes of storage,
+    // after the session store (if used). A setting with value 0 is not set.
+    #define SETTINGS_STORAGE_SIZE 32
+    #define SETTINGS_RECORD_VERSION 2
+
+    struct SettingsRecord
+    {
+        uint8_t version;
+        uint8_t size;
+        uint32_t doWorkIntervalSeconds;
+        uint8_t subBand;                    // Sub-band of the last join + 1 (USE_SUBBAND_DISCOVERY)
+        uint16_t crc;
+    };
+
+    struct SettingsRecordV1                 // Version 1, without subBand
+    {
+        uint8_t version;
+        uint8_t size;
+        uint32_t doWorkIntervalSeconds;
+        uint16_t crc;
+    };
+
+    static_assert(sizeof(SettingsRecord) <= SETTINGS_STORAGE_SIZE, "SettingsRecord too large.");
+    const uint16_t settingsAddress = STORAGE_SIZE - SETTINGS_STORAGE_SIZE;
+
+    bool storageReady = false;
+
+    bool storeSettings(SettingsRecord& settings)
+    {
+        // Storage only writes bytes that have changed.
+        settings.version = SETTINGS_RECORD_VERSION;
+        settings.size = sizeof(settings);
+        settings.crc = crc16(&settings, offsetof(SettingsRecord, crc));
+        return storageReady && storageWrite(settingsAddress, &settings, sizeof(settings));
+    }
+
+    bool loadSettings(SettingsRecord& settings)
+    {
+        // Returns false (and all settings 0) if no valid settings are stored.
+        // A version 1 record is migrated: it has the same leading fields 
+        // (without subBand) and is stored again as the current version.
+        if (storageReady && storageRead(settingsAddress, &settings, sizeof(settings)))
+        {
+            if (settings.version == SETTINGS_RECORD_VERSION
+                && settings.size == sizeof(settings)
+                && settings.crc == crc16(&settings, offsetof(SettingsRecord, crc)))
+            {
+                return true;
+            }
+            SettingsRecordV1 record;
+            if (settings.version == 1 && storageRead(settingsAddress, &record, sizeof(record))
+                && record.size == sizeof(record)
+                && record.crc == crc16(&record, offsetof(SettingsRecordV1, crc)))
+            {
+                memset(&settings, 0, sizeof(settings));
+                settings.doWorkIntervalSeconds = record.doWorkIntervalSeconds;
+                storeSettings(settings);
+                return true;
+            }
+        }
+        memset(&settings, 0, sizeof(settings));
+        return false;
+    }
+#endif
+
+
+#ifdef USE_SESSION_STORE
+    #ifndef MCCI_LMIC
+        #error USE_SESSION_STORE requires the MCCI LoRaWAN LMIC library.
+    #endif
+    #ifndef STORAGE_SIZE
+        #error USE_SESSION_STORE is not supported for this board (no STORAGE_SIZE defined in BSF).
+    #endif
+
+    #ifndef SESSION_COUNTER_INTERVAL
+        #define SESSION_COUNTER_INTERVAL 16     // Store frame counters every 16 uplinks
+    #endif
+    #define SESSION_RECORD_VERSION 1
+    #define SESSION_COUNTER_SLOTS_MAX 32
+
+    // Session parameters. Rewritten only when changed (after join, ADR or
+    // MAC commands), so these bytes are written rarely.
+    struct SessionRecord
+    {
+        uint8_t version;
+        uint16_t size;
+        uint16_t keyTag;                // Detects changed keys in lorawan-keys.h
+        u4_t netId;
+        devaddr_t devAddr;
+        u1_t nwkSKey[16];
+        u1_t appSKey[16];
+        bit_t adrEnabled;
+        dr_t dataRate;
+        s1_t txPower;
+        u1_t rx1DrOffset;
+        u1_t rxDelay;
+        dr_t dn2Dr;
+        u4_t dn2Freq;
+    #if CFG_LMIC_EU_like
+        decltype(LMIC.channelFreq) channelFreq;
+        decltype(LMIC.channelDrMap) channelDrMap;
+        decltype(LMIC.channelMap) channelMap;
+    #endif
+    #if CFG_LMIC_US_like
+        decltype(LMIC.channelMap) channelMap;
+    #endif
+        uint16_t crc;
+    };
+
+    // Frame counters change with every uplink. They are stored in a ring
+    // of slots after the session record, each write uses the next slot,
+    // so the writes are spread over all slots (wear leveling).
+    struct CounterRecord
+    {
+        u4_t seqnoUp;
+        u4_t seqnoDn;
+        uint16_t sessionTag;            // Ties counters to the session they belong to
+        uint16_t crc;
+    };
+
+    const uint16_t counterSlots = 
+        (settingsAddress - sizeof(SessionRecord)) / sizeof(CounterRecord) < SESSION_COUNTER_SLOTS_MAX ?
+        (settingsAddress - sizeof(SessionRecord)) / sizeof(CounterRecord) : SESSION_COUNTER_SLOTS_MAX;
+    static_assert(sizeof(SessionRecord) + 2 * sizeof(CounterRecord) <= STORAGE_SIZE - SETTINGS_STORAGE_SIZE, 
+                  "STORAGE_SIZE too small for session store.");
+
+    uint16_t sessionRecordCrc = 0;
+    uint16_t counterSlot = 0;
+    u4_t storedSeqnoUp = 0;
+
+    uint16_t keyTag()
+    {
+        #ifdef OTAA_ACTIVATION
+            const uint8_t keys[] = { OTAA_DEVEUI, OTAA_APPEUI, OTAA_APPKEY };
+        #else
+            const uint8_t keys[] = { ABP_NWKSKEY, ABP_APPSKEY };
+        #endif
+        return crc16(keys, sizeof(keys));
+    }
+
+    uint16_t sessionTag(devaddr_t devAddr, const u1_t* nwkSKey)
+    {
+        uint16_t tag = keyTag();
+        uint16_t crc = crc16(&tag, sizeof(tag));
+        crc = crc16(&devAddr, sizeof(devAddr), crc);
+        return crc16(nwkSKey, 16, crc);
+    }
+
+    void storeCounters()
+    {
+        CounterRecord counters;
+        counters.seqnoUp = LMIC.seqnoUp;
+        counters.seqnoDn = LMIC.seqnoDn;
+        counters.sessionTag = sessionTag(LMIC.devaddr, LMIC.nwkKey);
+        counters.crc = crc16(&counters, offsetof(CounterRecord, crc));
+        counterSlot = (counterSlot + 1) % counterSlots;
+        if (storageWrite(sizeof(SessionRecord) + counterSlot * sizeof(CounterRecord), 
+                         &counters, sizeof(counters)))
+        {
+            storedSeqnoUp = LMIC.seqnoUp;
+        }
+    }
+
+    void storeSession(bool force = false)
+    {
+        // Stores the current session. Session parameters are only written if 
+        // they have changed, frame counters only every SESSION_COUNTER_INTERVAL 
+        // uplinks unless force is true.
+        #ifdef OTAA_ACTIVATION
+            SessionRecord record;
+            memset(&record, 0, sizeof(record));     // Zero padding bytes, they are included in CRC
+            record.version = SESSION_RECORD_VERSION;
+            record.size = sizeof(record);
+            record.keyTag = keyTag();
+            record.netId = LMIC.netid;
+            record.devAddr = LMIC.devaddr;
+            memcpy(record.nwkSKey, LMIC.nwkKey, sizeof(record.nwkSKey));
+            memcpy(record.appSKey, LMIC.artKey, sizeof(record.appSKey));
+            record.adrEnabled = LMIC.adrEnabled;
+            record.dataRate = LMIC.datarate;
+            record.txPower = LMIC.adrTxPow;
+            record.rx1DrOffset = LMIC.rx1DrOffset;
+            record.rxDelay = LMIC.rxDelay;
+            record.dn2Dr = LMIC.dn2Dr;
+            record.dn2Freq = LMIC.dn2Freq;
+            #if CFG_LMIC_EU_like
+                memcpy(record.channelFreq, LMIC.channelFreq, sizeof(record.channelFreq));
+                memcpy(record.channelDrMap, LMIC.channelDrMap, sizeof(record.channelDrMap));
+                record.channelMap = LMIC.channelMap;
+            #endif
+            #if CFG_LMIC_US_like
+                memcpy(record.channelMap, LMIC.channelMap, sizeof(record.channelMap));
+            #endif
+            record.crc = crc16(&record, offsetof(SessionRecord, crc));
+            if (record.crc != sessionRecordCrc && storageWrite(0, &record, sizeof(record)))
+            {
+                sessionRecordCrc = record.crc;
+            }
+        #endif
+
+        if (force || LMIC.seqnoUp - storedSeqnoUp >= SESSION_COUNTER_INTERVAL)
+        {
+            storeCounters();
+        }
+    }
+
+    bool restoreSession()
+    {
+        // Restores a stored session, must be called after LMIC_reset()
+        // (and for ABP after setAbpParameters()). 
+        // Returns false if there is no valid stored session.
+        if (!storageReady)
+        {
+            return false;
+        }
+
+        #ifdef OTAA_ACTIVATION
+            SessionRecord record;
+            if (!storageRead(0, &record, sizeof(record))
+                || record.version != SESSION_RECORD_VERSION
+                || record.size != sizeof(record)
+                || record.crc != crc16(&record, offsetof(SessionRecord, crc))
+                || record.keyTag != keyTag())
+            {
+                return false;
+            }
+            uint16_t tag = sessionTag(record.devAddr, record.nwkSKey);
+        #else
+            uint16_t tag = sessionTag(LMIC.devaddr, LMIC.nwkKey);
+        #endif
+
+        // Find the most recent frame counters for this session.
+        CounterRecord latest = {};
+        bool found = false;
+        for (uint16_t slot = 0; slot < counterSlots; ++slot)
+        {
+            CounterRecord counters;
+            if (storageRead(sizeof(SessionRecord) + slot * sizeof(CounterRecord), &counters, sizeof(counters))
+                && counters.crc == crc16(&counters, offsetof(CounterRecord, crc))
+                && counters.sessionTag == tag
+                && (!found || counters.seqnoUp > latest.seqnoUp))
+            {
+                latest = counters;
+                counterSlot = slot;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            return false;
+        }
+
+        #ifdef OTAA_ACTIVATION
+            // LMIC_setSession() resets channels and MAC parameters,
+            // restore them afterwards.
+            LMIC_setSession(record.netId, record.devAddr, record.nwkSKey, record.appSKey);
+            LMIC_setAdrMode(record.adrEnabled);
+            LMIC_setDrTxpow(record.dataRate, record.txPower);
+            LMIC.rx1DrOffset = record.rx1DrOffset;
+            LMIC.rxDelay = record.rxDelay;
+            LMIC.dn2Dr = record.dn2Dr;
+            LMIC.dn2Freq = record.dn2Freq;
+            #if CFG_LMIC_EU_like
+                memcpy(LMIC.channelFreq, record.channelFreq, sizeof(LMIC.channelFreq));
+                memcpy(LMIC.channelDrMap, record.channelDrMap, sizeof(LMIC.channelDrMap));
+                LMIC.channelMap = record.channelMap;
+            #endif
+            #if CFG_LMIC_US_like
+                // Use the LMIC functions, they also update the active channel counts.
+                for (uint8_t channel = 0; channel < 72; ++channel)
+                {
+                    if (record.channelMap[channel / 16] & (1 << (channel % 16)))
+                    {
+                        LMIC_enableChannel(channel);
+                    }
+                    else
+                    {
+                        LMIC_disableChannel(channel);
+                    }
+                }
+            #endif
+            sessionRecordCrc = record.crc;
+        #endif
+
+        // Up to SESSION_COUNTER_INTERVAL - 1 uplinks may have been sent after
+        // the counters were stored. Skip ahead so frame counters are never reused.
+        LMIC.seqnoUp = latest.seqnoUp + SESSION_COUNTER_INTERVAL;
+        LMIC.seqnoDn = latest.seqnoDn;
+        storeCounters();
+        return true;
+    }
+
+    void clearSession()
+    {
+        // Invalidates the stored session (e.g. when the network no longer responds).
+        CounterRecord empty;
+        memset(&empty, 0xFF, sizeof(empty));
+        for (uint16_t slot = 0; slot < counterSlots; ++slot)
+        {
+            storageWrite(sizeof(SessionRecord) + slot * sizeof(CounterRecord), &empty, sizeof(empty));
+        }
+        storedSeqnoUp = 0;
+    }
+#endif
+
+
+#ifdef USE_SLEEP
+    #ifndef MCCI_LMIC
+        #error USE_SLEEP requires the MCCI LoRaWAN LMIC library.
+    #endif
+    #ifndef SLEEP_MIN_MS
+        #error USE_SLEEP is not supported for this board (no sleep implementation in BSF).
+    #endif
+
+    #ifndef SLEEP_WAKEUP_MARGIN_MS
+        #define SLEEP_WAKEUP_MARGIN_MS 10   // Wake up this long before the next job is due
+    #endif
+
+    void sleepUntil(ostime_t wakeupTime)
+    {
+        // Sleeps until (SLEEP_WAKEUP_MARGIN_MS before) wakeupTime if LMIC is idle:
+        // not joining, no uplink pending or in progress and no LMIC job
+        // scheduled before wakeupTime. Returns immediately otherwise.
+        // The BSF's boardSleep() corrects the Arduino/LMIC time base
+        // for the time slept, so scheduled jobs stay on time.
+        if (LMIC.opmode & (OP_JOINING | OP_TXDATA | OP_POLL | OP_TXRXPEND))
+        {
+            return;
+        }
+        #if defined(USE_SERIAL) && defined(USE_SERIAL_LOG_BUFFER)
+            if (serialLog.pending() != 0)
+            {
+                return;
+            }
+        #endif
+        #ifdef USE_DISPLAY
+            if (screen.dirty())
+            {
+                return;
+            }
+        #endif
+
+        ostime_t now = os_getTime();
+        ostime_t sleepEnd = wakeupTime - ms2osticks(SLEEP_WAKEUP_MARGIN_MS);
+        ostime_t sleepTicks = sleepEnd - now;
+        if (sleepTicks < ms2osticks(SLEEP_MIN_MS) || os_queryTimeCriticalJobs(sleepEnd))
+        {
+            return;
+        }
+
+        #ifdef USE_SERIAL
+            // Complete pending serial output, the UART may stop while sleeping.
+            serial.flush();
+        #endif
+        boardSleep(osticks2ms(sleepTicks));
+    }
+#endif
+
+
 #endif  // LMIC_NODE_H_
@@ -140,6 +140,16 @@ const lmic_pinmap lmic_pins = {
 #endif
 
 
+// USE_SESSION_STORE is not supported: EEPROM is emulated in flash memory and
+// every write erases a flash page, storing frame counters would wear it out.
+
+
+#ifdef USE_SLEEP
+    // Sleep while waiting for the next doWork job.
+    #include "sleep_stm32.h"
+#endif
+
+
 bool boardInit(InitType initType)
 {
     // This function is used to perform board specific initializations.
@@ -114,6 +114,20 @@ const lmic_pinmap lmic_pins = {
 #endif
 
 
+#ifdef USE_SESSION_STORE
+    // Non-volatile storage used to persist the LoRaWAN session.
+    // Uses NVS, which spreads writes over the NVS partition.
+    #define STORAGE_SIZE 512
+    #include "storage_nvs.h"
+#endif
+
+
+#ifdef USE_SLEEP
+    // Sleep while waiting for the next doWork job.
+    #include "sleep_esp32.h"
+#endif
+
+
 bool boardInit(InitType initType)
 {
     // This function is used to perform board specific initializations.
@@ -109,6 +109,14 @@ const lmic_pinmap lmic_pins = {
 #endif
 
 
+#ifdef USE_SESSION_STORE
+    // Non-volatile storage used to persist the LoRaWAN session.
+    // Uses the MCU's built-in EEPROM.
+    #define STORAGE_SIZE 512
+    #include "storage_eeprom.h"
+#endif
+
+
 bool boardInit(InitType initType)
 {
     // This function is used to perform board specific initializations.
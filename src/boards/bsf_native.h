@@ -0,0 +1,128 @@
+/*******************************************************************************
+ *
+ *  File:         bsf_native.h
+ *
+ *  Function:     Board Support File for the host-native simulation build.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  This is not a physical board. It is used to build and run
+ *                LMIC-node on the development host (Linux, macOS) with
+ *                PlatformIO's native platform, for simulation, tuning and
+ *                benchmarking without a board or gateway.
+ *
+ *                The Arduino core, LMIC library, U8x8 display library and
+ *                EasyLed are replaced by stand-ins located in the native
+ *                folder (see native/lmic-sim.cpp). The LMIC stand-in mirrors
+ *                the MCCI LoRaWAN LMIC library API and simulates joins,
+ *                uplinks, RX windows and downlinks against a virtual clock.
+ *
+ *                Serial output is written to stdout. The display is kept
+ *                in memory and the data transferred to it is counted.
+ *
+ *                Build and run:
+ *                pio run -e native -t exec
+ *                .pio/build/native/program -t 86400 -q -d 10
+ *
+ *  Identifiers:  LMIC-node
+ *                    board:         native
+ *                PlatformIO
+ *                    platform:      native
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef BSF_NATIVE_H_
+#define BSF_NATIVE_H_
+
+#include "LMIC-node.h"
+
+#define DEVICEID_DEFAULT "native"  // Default deviceid value
+
+// Wait for Serial
+// Can be useful for boards with MCU with integrated USB support.
+// #define WAITFOR_SERIAL_SECONDS_DEFAULT 10   // -1 waits indefinitely
+
+// LMIC Clock Error
+// This is only needed for slower 8-bit MCUs (e.g. 8MHz ATmega328 and ATmega32u4).
+// Value is defined in parts per million (of MAX_CLOCK_ERROR).
+// #ifndef LMIC_CLOCK_ERROR_PPM
+//     #define LMIC_CLOCK_ERROR_PPM 0
+// #endif
+
+// Pin mappings for LoRa tranceiver (not used by the simulator)
+const lmic_pinmap lmic_pins = {
+    .nss = 10,
+    .rxtx = LMIC_UNUSED_PIN,
+    .rst = 9,
+    .dio = { /*dio0*/ 2, /*dio1*/ 3, /*dio2*/ LMIC_UNUSED_PIN }
+#ifdef MCCI_LMIC
+    ,
+    .rxtx_rx_active = 0,
+    .rssi_cal = 10,
+    .spi_freq = 8000000     /* 8 MHz */
+#endif
+};
+
+#ifdef USE_SERIAL
+    HardwareSerial& serial = Serial;
+#endif
+
+#ifdef USE_LED
+    EasyLed led(13, EasyLed::ActiveLevel::High);
+#endif
+
+#ifdef USE_DISPLAY
+    // Create U8x8 instance for simulated SSD1306 OLED display.
+    U8X8_SSD1306_128X64_NONAME_HW_I2C display(/*rst*/ U8X8_PIN_NONE);
+#endif
+
+
+#ifdef USE_SESSION_STORE
+    // Non-volatile storage used to persist the LoRaWAN session.
+    // Simulated EEPROM, see native/EEPROM.h.
+    #define STORAGE_SIZE 512
+    #include "storage_eeprom.h"
+#endif
+
+
+#ifdef USE_SLEEP
+    // Simulated sleep: the virtual clock advances by the time slept
+    // and the time is counted (see native/lmic-sim.cpp).
+    #include "lmic-sim.h"
+    #define SLEEP_MIN_MS 10
+    void boardSleep(uint32_t ms) { simSleepUs((uint64_t)ms * 1000); }
+#endif
+
+
+bool boardInit(InitType initType)
+{
+    // This function is used to perform board specific initializations.
+    // Required as part of standard template.
+
+    // InitType::Hardware        Must be called at start of setup() before anything else.
+    // InitType::PostInitSerial  Must be called after initSerial() before other initializations.
+
+    bool success = true;
+    switch (initType)
+    {
+        case InitType::Hardware:
+            // Note: Serial port and display are not yet initialized and cannot be used use here.
+            // No actions required for this board.
+            break;
+
+        case InitType::PostInitSerial:
+            // Note: If enabled Serial port and display are already initialized here.
+            // No actions required for this board.
+            break;
+    }
+    return success;
+}
+
+
+#endif  // BSF_NATIVE_H_
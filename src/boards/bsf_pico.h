@@ -129,6 +129,10 @@ const lmic_pinmap lmic_pins = {
 #endif
 
 
+// USE_SESSION_STORE is not supported: EEPROM is emulated in flash memory and
+// every write erases a flash page, storing frame counters would wear it out.
+
+
 bool boardInit(InitType initType)
 {
     // This function is used to perform board specific initializations.
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ *
+ *  File:         sleep_avr.h
+ *
+ *  Function:     Sleep implementation for AVR (ATmega328) boards.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Implements boardSleep() used by LMIC-node (USE_SLEEP).
+ *                To be included from a Board Support File.
+ *
+ *                Uses power-down mode with watchdog interrupt wakeup.
+ *                The sleep time is split into watchdog periods
+ *                (16 ms to 8 s). Timer 0 is stopped in power-down mode so
+ *                millis() and micros() do not advance. After wakeup the
+ *                Arduino core's timer 0 counters are advanced by the time
+ *                slept, which also corrects the LMIC time base (LMIC time 
+ *                is derived from micros()).
+ *
+ *                The watchdog oscillator has a tolerance of about 10%, so
+ *                the time actually slept may differ from the time added.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef SLEEP_AVR_H_
+#define SLEEP_AVR_H_
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+#define SLEEP_MIN_MS 16     // Shortest watchdog period
+
+// Defined in the Arduino AVR core (wiring.c)
+extern volatile unsigned long timer0_overflow_count;
+extern volatile unsigned long timer0_millis;
+
+
+ISR(WDT_vect)
+{
+    // Wakeup only.
+    wdt_disable();
+}
+
+
+void sleepWatchdogPeriod(uint8_t period)
+{
+    // Power-down for 16 ms << period (period 0-9).
+    uint8_t prescaler = ((period & 0x08) ? _BV(WDP3) : 0) | (period & 0x07);
+    cli();
+    MCUSR &= ~_BV(WDRF);
+    WDTCSR = _BV(WDCE) | _BV(WDE);
+    WDTCSR = _BV(WDIE) | prescaler;     // Interrupt mode, no reset
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
+
+
+void boardSleep(uint32_t ms)
+{
+    uint32_t slept = 0;
+    while (ms - slept >= SLEEP_MIN_MS)
+    {
+        uint8_t period = 9;
+        while ((16UL << period) > ms - slept)
+        {
+            --period;
+        }
+        sleepWatchdogPeriod(period);
+        slept += 16UL << period;
+    }
+
+    // Advance Arduino (and thereby LMIC) time by the time slept.
+    const uint32_t usPerOverflow = 64UL * 256 / clockCyclesPerMicrosecond();
+    uint8_t oldSREG = SREG;
+    cli();
+    timer0_millis += slept;
+    timer0_overflow_count += (uint32_t)((uint64_t)slept * 1000 / usPerOverflow);
+    SREG = oldSREG;
+}
+
+
+#endif  // SLEEP_AVR_H_
@@ -0,0 +1,44 @@
+/*******************************************************************************
+ *
+ *  File:         sleep_esp32.h
+ *
+ *  Function:     Sleep implementation for ESP32 boards.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Implements boardSleep() used by LMIC-node (USE_SLEEP).
+ *                To be included from a Board Support File.
+ *
+ *                Uses light sleep with timer wakeup. RAM and CPU state are
+ *                retained so LMIC state is preserved. The timer used by
+ *                micros() (esp_timer) is corrected for the sleep time by
+ *                ESP-IDF, so the LMIC time base needs no fix-up.
+ *
+ *                Deep sleep is not used because it resets the MCU. Combine
+ *                with USE_SESSION_STORE if deep sleep is preferred (the
+ *                session is then restored instead of joining again).
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef SLEEP_ESP32_H_
+#define SLEEP_ESP32_H_
+
+#include <esp_sleep.h>
+
+#define SLEEP_MIN_MS 10     // Shorter sleeps are not worth the wakeup time
+
+
+void boardSleep(uint32_t ms)
+{
+    esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+    esp_light_sleep_start();
+}
+
+
+#endif  // SLEEP_ESP32_H_
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ *
+ *  File:         sleep_stm32.h
+ *
+ *  Function:     Sleep implementation for STM32 boards.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Implements boardSleep() used by LMIC-node (USE_SLEEP).
+ *                To be included from a Board Support File.
+ *
+ *                Uses stop mode (STM32duino Low Power library) with RTC
+ *                wakeup. RAM is retained so LMIC state is preserved.
+ *                SysTick is stopped in stop mode so millis() and micros()
+ *                do not advance. After wakeup the HAL tick counter is
+ *                advanced by the time slept, which also corrects the LMIC
+ *                time base (LMIC time is derived from micros()).
+ *
+ *                Requires libraries stm32duino/STM32duino Low Power and
+ *                stm32duino/STM32duino RTC, add these to lib_deps.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef SLEEP_STM32_H_
+#define SLEEP_STM32_H_
+
+#include <STM32LowPower.h>
+
+#define SLEEP_MIN_MS 10     // Shorter sleeps are not worth the wakeup time
+
+// Defined in the STM32 HAL (stm32xxxx_hal.c)
+extern "C" __IO uint32_t uwTick;
+
+
+void boardSleep(uint32_t ms)
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        LowPower.begin();
+        initialized = true;
+    }
+    LowPower.deepSleep(ms);
+
+    // Advance Arduino (and thereby LMIC) time by the time slept.
+    uwTick += ms;
+}
+
+
+#endif  // SLEEP_STM32_H_
@@ -0,0 +1,117 @@
+/*******************************************************************************
+ *
+ *  File:         storage_eeprom.h
+ *
+ *  Function:     Non-volatile storage implementation using the Arduino EEPROM library.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Implements the storage interface used by LMIC-node
+ *                (storageInit, storageRead, storageWrite) for boards
+ *                that support the Arduino EEPROM library.
+ *                To be included from a Board Support File which must
+ *                define STORAGE_SIZE (number of bytes, starting at address 0).
+ *
+ *                Only for MCUs with real EEPROM (e.g. AVR and STM32L0).
+ *                Where EEPROM is emulated in flash memory (ESP32, ESP8266,
+ *                RP2040, STM32F1) every commit erases a flash page, which
+ *                wears out the flash when frame counters are stored.
+ *                Use storage_nvs.h for ESP32.
+ *
+ *                Only bytes that have changed are written.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef STORAGE_EEPROM_H_
+#define STORAGE_EEPROM_H_
+
+#include <EEPROM.h>
+
+#ifndef STORAGE_SIZE
+    #error STORAGE_SIZE must be defined before including storage_eeprom.h.
+#endif
+
+#if defined(ARDUINO_ARCH_NATIVE)
+    #define STORAGE_EEPROM_COMMIT    // Simulated EEPROM requires begin() and commit()
+#endif
+
+
+bool storageInit()
+{
+    #ifdef STORAGE_EEPROM_COMMIT
+        EEPROM.begin(STORAGE_SIZE);
+    #endif
+    return true;
+}
+
+
+bool storageRead(uint16_t address, void* data, uint16_t length)
+{
+    if (address + length > STORAGE_SIZE)
+    {
+        return false;
+    }
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    for (uint16_t i = 0; i < length; ++i)
+    {
+        bytes[i] = EEPROM.read(address + i);
+    }
+    return true;
+}
+
+
+bool storageWrite(uint16_t address, const void* data, uint16_t length)
+{
+    if (address + length > STORAGE_SIZE)
+    {
+        return false;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    #if defined(ARDUINO_ARCH_STM32)
+        // Write all changes at once instead of per byte,
+        // and only if any byte has changed.
+        eeprom_buffer_fill();
+        bool changed = false;
+        for (uint16_t i = 0; i < length; ++i)
+        {
+            if (eeprom_buffered_read_byte(address + i) != bytes[i])
+            {
+                eeprom_buffered_write_byte(address + i, bytes[i]);
+                changed = true;
+            }
+        }
+        if (changed)
+        {
+            eeprom_buffer_flush();
+        }
+        return true;
+    #else
+        bool changed = false;
+        for (uint16_t i = 0; i < length; ++i)
+        {
+            if (EEPROM.read(address + i) != bytes[i])
+            {
+                EEPROM.write(address + i, bytes[i]);
+                changed = true;
+            }
+        }
+        #ifdef STORAGE_EEPROM_COMMIT
+            if (changed)
+            {
+                return EEPROM.commit();
+            }
+        #endif
+        (void)changed;
+        return true;
+    #endif
+}
+
+
+#endif  // STORAGE_EEPROM_H_
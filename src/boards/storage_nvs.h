@@ -0,0 +1,138 @@
+/*******************************************************************************
+ *
+ *  File:         storage_nvs.h
+ *
+ *  Function:     Non-volatile storage implementation using ESP32 NVS.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Implements the storage interface used by LMIC-node
+ *                (storageInit, storageRead, storageWrite) for ESP32 boards
+ *                with the Preferences library (NVS partition).
+ *                To be included from a Board Support File which must
+ *                define STORAGE_SIZE (number of bytes, starting at address 0).
+ *
+ *                The emulated EEPROM of the ESP32 core erases a flash sector
+ *                on every commit, which wears out the flash when frame
+ *                counters are stored. NVS appends changed entries to the
+ *                current page and only erases a page when all pages are
+ *                full, so writes are spread over the NVS partition.
+ *
+ *                Storage is divided in blocks of STORAGE_NVS_BLOCK_SIZE bytes,
+ *                each stored under its own key. Only blocks that have changed
+ *                are written. Blocks that were never written read as 0xFF,
+ *                like erased EEPROM.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef STORAGE_NVS_H_
+#define STORAGE_NVS_H_
+
+#include <Preferences.h>
+
+#ifndef STORAGE_SIZE
+    #error STORAGE_SIZE must be defined before including storage_nvs.h.
+#endif
+
+#define STORAGE_NVS_NAMESPACE "lmic-node"
+#define STORAGE_NVS_BLOCK_SIZE 32
+
+static_assert(STORAGE_SIZE % STORAGE_NVS_BLOCK_SIZE == 0 && STORAGE_SIZE / STORAGE_NVS_BLOCK_SIZE <= 100,
+              "STORAGE_SIZE must be a multiple of STORAGE_NVS_BLOCK_SIZE, max 100 blocks.");
+
+Preferences storagePreferences;
+
+
+bool storageInit()
+{
+    return storagePreferences.begin(STORAGE_NVS_NAMESPACE, false);
+}
+
+
+static void storageBlockKey(uint16_t block, char* key)
+{
+    // Key "b0" .. "b99".
+    uint8_t i = 0;
+    key[i++] = 'b';
+    if (block >= 10)
+    {
+        key[i++] = '0' + block / 10;
+    }
+    key[i++] = '0' + block % 10;
+    key[i] = '\0';
+}
+
+
+static void storageReadBlock(uint16_t block, uint8_t* data)
+{
+    char key[8];
+    storageBlockKey(block, key);
+    if (storagePreferences.getBytesLength(key) != STORAGE_NVS_BLOCK_SIZE
+        || storagePreferences.getBytes(key, data, STORAGE_NVS_BLOCK_SIZE) != STORAGE_NVS_BLOCK_SIZE)
+    {
+        memset(data, 0xFF, STORAGE_NVS_BLOCK_SIZE);
+    }
+}
+
+
+bool storageRead(uint16_t address, void* data, uint16_t length)
+{
+    if (address + length > STORAGE_SIZE)
+    {
+        return false;
+    }
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    uint8_t block[STORAGE_NVS_BLOCK_SIZE];
+    while (length > 0)
+    {
+        uint16_t offset = address % STORAGE_NVS_BLOCK_SIZE;
+        uint16_t count = STORAGE_NVS_BLOCK_SIZE - offset < length ? STORAGE_NVS_BLOCK_SIZE - offset : length;
+        storageReadBlock(address / STORAGE_NVS_BLOCK_SIZE, block);
+        memcpy(bytes, block + offset, count);
+        address += count;
+        bytes += count;
+        length -= count;
+    }
+    return true;
+}
+
+
+bool storageWrite(uint16_t address, const void* data, uint16_t length)
+{
+    if (address + length > STORAGE_SIZE)
+    {
+        return false;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint8_t block[STORAGE_NVS_BLOCK_SIZE];
+    while (length > 0)
+    {
+        uint16_t offset = address % STORAGE_NVS_BLOCK_SIZE;
+        uint16_t count = STORAGE_NVS_BLOCK_SIZE - offset < length ? STORAGE_NVS_BLOCK_SIZE - offset : length;
+        uint16_t blockNumber = address / STORAGE_NVS_BLOCK_SIZE;
+        storageReadBlock(blockNumber, block);
+        if (memcmp(block + offset, bytes, count) != 0)
+        {
+            memcpy(block + offset, bytes, count);
+            char key[8];
+            storageBlockKey(blockNumber, key);
+            if (storagePreferences.putBytes(key, block, STORAGE_NVS_BLOCK_SIZE) != STORAGE_NVS_BLOCK_SIZE)
+            {
+                return false;
+            }
+        }
+        address += count;
+        bytes += count;
+        length -= count;
+    }
+    return true;
+}
+
+
+#endif  // STORAGE_NVS_H_
@@ -0,0 +1,292 @@
+/*******************************************************************************
+ *
+ *  File:         payload-encoding.h
+ *
+ *  Function:     Bit packing and time series compression for payloads.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  BitWriter, BitReader, DeltaCompressor and XorCompressor,
+ *                used to encode uplink payloads and to decode downlink
+ *                payloads. The matching decoders (readBits(),
+ *                decodeDeltaSamples(), decodeXorSamples()) are in
+ *                payload-formatters/lmic-node-uplink-formatters.js.
+ *
+ *                Has no dependencies on Arduino or LMIC, so it is also
+ *                used by the unit tests in the test folder.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef PAYLOAD_ENCODING_H_
+#define PAYLOAD_ENCODING_H_
+
+#include <stdint.h>
+#include <string.h>
+
+
+// Bit packing: values of 1-32 bits are written to and read from a byte buffer 
+// most significant bit first, without padding between values.
+
+inline void writeBits(uint8_t* buffer, uint16_t bitOffset, uint32_t value, uint8_t bits)
+{
+    // Writes the bits least significant bits of value to buffer, starting at bitOffset.
+    // The destination bits must be zero. Writes at most 8 bits per step.
+    while (bits > 0)
+    {
+        uint8_t room = 8 - (bitOffset & 7);
+        uint8_t count = bits < room ? bits : room;
+        uint8_t chunk = (value >> (bits - count)) & ((1U << count) - 1);
+        buffer[bitOffset >> 3] |= chunk << (room - count);
+        bitOffset += count;
+        bits -= count;
+    }
+}
+
+inline uint32_t readBits(const uint8_t* buffer, uint16_t bitOffset, uint8_t bits)
+{
+    // Reads bits bits from buffer, starting at bitOffset.
+    uint32_t value = 0;
+    while (bits > 0)
+    {
+        uint8_t room = 8 - (bitOffset & 7);
+        uint8_t count = bits < room ? bits : room;
+        uint8_t chunk = (buffer[bitOffset >> 3] >> (room - count)) & ((1U << count) - 1);
+        value = (value << count) | chunk;
+        bitOffset += count;
+        bits -= count;
+    }
+    return value;
+}
+
+
+class BitWriter
+{
+    // Packs values into a buffer, e.g. payloadBuffer.
+    // Writes that do not fit are discarded and set overflow().
+    //
+    // BitWriter writer(payloadBuffer, payloadBufferLength);
+    // writer.write(batteryLevel, 7);
+    // writer.writeSigned(temperatureTenths, 11);
+    // uint8_t payloadLength = writer.length();
+
+public:
+    BitWriter(uint8_t* buffer, uint8_t size) : buffer_(buffer), size_(size)
+    {
+        memset(buffer, 0, size);
+    }
+
+    bool write(uint32_t value, uint8_t bits)
+    {
+        if (bits > 32 || bitLength_ + bits > size_ * 8U)
+        {
+            overflow_ = true;
+            return false;
+        }
+        writeBits(buffer_, bitLength_, value, bits);
+        bitLength_ += bits;
+        return true;
+    }
+
+    bool writeSigned(int32_t value, uint8_t bits)
+    {
+        // Two's complement, value must fit in bits.
+        return write(static_cast<uint32_t>(value), bits);
+    }
+
+    uint16_t bitLength() const { return bitLength_; }
+    uint8_t length() const { return (bitLength_ + 7) / 8; }     // Bytes used
+    bool overflow() const { return overflow_; }
+
+private:
+    uint8_t* buffer_;
+    uint8_t size_;
+    uint16_t bitLength_ = 0;
+    bool overflow_ = false;
+};
+
+
+class BitReader
+{
+    // Unpacks values written by BitWriter, e.g. from a downlink payload.
+    // Reads beyond the end of the data return 0 and set overflow().
+
+public:
+    BitReader(const uint8_t* data, uint8_t length) : data_(data), length_(length) {}
+
+    uint32_t read(uint8_t bits)
+    {
+        if (bits > 32 || bitOffset_ + bits > length_ * 8U)
+        {
+            overflow_ = true;
+            return 0;
+        }
+        uint32_t value = readBits(data_, bitOffset_, bits);
+        bitOffset_ += bits;
+        return value;
+    }
+
+    int32_t readSigned(uint8_t bits)
+    {
+        uint32_t value = read(bits);
+        if (bits > 0 && bits < 32 && (value >> (bits - 1)) & 1)
+        {
+            value |= ~0UL << bits;      // Sign extend
+        }
+        return static_cast<int32_t>(value);
+    }
+
+    uint16_t remainingBits() const { return length_ * 8U - bitOffset_; }
+    bool overflow() const { return overflow_; }
+
+private:
+    const uint8_t* data_;
+    uint8_t length_;
+    uint16_t bitOffset_ = 0;
+    bool overflow_ = false;
+};
+
+
+// Time series compression: each sample is encoded relative to the previous
+// sample, so slowly changing values take only one or two bytes.
+// The previous value starts at 0, so the first sample is encoded as is.
+
+inline uint32_t zigzagEncode(int32_t value)
+{
+    // Maps signed to unsigned values with small magnitude: 0, -1, 1, -2, 2 .. to 0, 1, 2, 3, 4 ..
+    return (static_cast<uint32_t>(value) << 1) ^ (value < 0 ? 0xFFFFFFFFUL : 0);
+}
+
+inline uint8_t varintLength(uint32_t value)
+{
+    uint8_t length = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        ++length;
+    }
+    return length;
+}
+
+inline uint8_t writeVarint(uint8_t* buffer, uint32_t value)
+{
+    // Writes value in groups of 7 bits, least significant first,
+    // with the high bit set if more bytes follow. Returns the number of bytes written (1-5).
+    uint8_t length = 0;
+    while (value >= 0x80)
+    {
+        buffer[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buffer[length++] = value;
+    return length;
+}
+
+
+class DeltaCompressor
+{
+    // Integer samples: the difference with the previous sample as zigzag 
+    // encoded varint (1 byte for -64 .. 63, 2 bytes for -8192 .. 8191, etc.).
+    // Decoded by decodeDeltaSamples() in the uplink formatter.
+
+public:
+    DeltaCompressor(uint8_t* buffer, uint8_t size) : buffer_(buffer), size_(size) {}
+
+    static uint8_t encodedLength(int32_t sample, int32_t previous)
+    {
+        return varintLength(zigzagEncode(sample - previous));
+    }
+
+    bool add(int32_t sample)
+    {
+        // Returns false (and writes nothing) if the sample does not fit.
+        int32_t delta = static_cast<int32_t>(static_cast<uint32_t>(sample) - static_cast<uint32_t>(previous_));
+        uint32_t value = zigzagEncode(delta);
+        if (length_ + varintLength(value) > size_)
+        {
+            return false;
+        }
+        length_ += writeVarint(buffer_ + length_, value);
+        previous_ = sample;
+        ++count_;
+        return true;
+    }
+
+    uint8_t length() const { return length_; }      // Bytes used
+    uint8_t count() const { return count_; }        // Samples added
+
+private:
+    uint8_t* buffer_;
+    uint8_t size_;
+    uint8_t length_ = 0;
+    uint8_t count_ = 0;
+    int32_t previous_ = 0;
+};
+
+
+class XorCompressor
+{
+    // Floating point samples: the XOR of the bit patterns of the sample and the
+    // previous sample, without leading and trailing zero bytes. A control byte
+    // holds the number of leading zero bytes (high nibble) and the number of 
+    // bytes that follow (low nibble). Equal samples take 1 byte, samples that only
+    // differ in the upper mantissa bits (e.g. 21.50 and 21.75) take 2 bytes.
+    // Decoded by decodeXorSamples() in the uplink formatter.
+
+public:
+    XorCompressor(uint8_t* buffer, uint8_t size) : buffer_(buffer), size_(size) {}
+
+    bool add(float sample)
+    {
+        // Returns false (and writes nothing) if the sample does not fit.
+        static_assert(sizeof(float) == 4, "XorCompressor requires 32-bit float.");
+        uint32_t bits;
+        memcpy(&bits, &sample, sizeof(bits));
+        uint32_t value = bits ^ previous_;
+        uint8_t leading = 0;
+        uint8_t meaningful = 0;
+        if (value != 0)
+        {
+            while ((value >> (24 - leading * 8)) == 0)
+            {
+                ++leading;
+            }
+            uint8_t trailing = 0;
+            while (((value >> (trailing * 8)) & 0xFF) == 0)
+            {
+                ++trailing;
+            }
+            meaningful = 4 - leading - trailing;
+        }
+        if (length_ + 1 + meaningful > size_)
+        {
+            return false;
+        }
+        buffer_[length_++] = (leading << 4) | meaningful;
+        for (uint8_t i = leading; i < leading + meaningful; ++i)
+        {
+            buffer_[length_++] = value >> (24 - i * 8);
+        }
+        previous_ = bits;
+        ++count_;
+        return true;
+    }
+
+    uint8_t length() const { return length_; }      // Bytes used
+    uint8_t count() const { return count_; }        // Samples added
+
+private:
+    uint8_t* buffer_;
+    uint8_t size_;
+    uint8_t length_ = 0;
+    uint8_t count_ = 0;
+    uint32_t previous_ = 0;
+};
+
+
+#endif  // PAYLOAD_ENCODING_H_
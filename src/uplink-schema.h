@@ -0,0 +1,75 @@
+/*******************************************************************************
+ *
+ *  File:         uplink-schema.h
+ *
+ *  Function:     Uplink payload schema.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Defines the fields of the uplink payload (fPort 10).
+ *                The payload encoder (encodeUplink(), struct UplinkData) and
+ *                the payload length (uplinkPayloadLength) are derived from 
+ *                this schema at compile time. The matching decoder in
+ *                payload-formatters/lmic-node-uplink-formatters.js is
+ *                generated from this file with:
+ *
+ *                python3 tools/generate-formatter.py
+ *
+ *                Each field is specified as:
+ *                FIELD(name, type, bits, scale, offset)
+ *
+ *                name    Field name, used in UplinkData and in the decoder output.
+ *                type    C++ type of the value in UplinkData. Signed and 
+ *                        floating point types are sent as signed (two's
+ *                        complement) values, unsigned types as unsigned.
+ *                bits    Number of bits on air (1-32).
+ *                scale   Value sent is (value - offset) * scale, rounded.
+ *                        Can be fractional (e.g. 0.1).
+ *                offset  Decoded value is raw / scale + offset.
+ *
+ *                Fields are packed in order, most significant bit first,
+ *                without padding. The payload length is rounded up to 
+ *                whole bytes. Values outside a field's range are clamped.
+ *
+ *                Examples:
+ *                Temperature -102.4 .. 102.3 °C, 0.1 °C resolution, 11 bits:
+ *                FIELD(temperature, float, 11, 10, 0)
+ *                Battery voltage 2000 .. 4550 mV, 10 mV resolution, 8 bits:
+ *                FIELD(batteryMv, uint16_t, 8, 0.1, 2000)
+ *
+ *                With send-on-change reporting (USE_REPORT_ON_CHANGE) an
+ *                uplink is only sent when a field has changed meaningfully.
+ *                Deadbands are specified per field as:
+ *                DEADBAND(name, absolute, relative)
+ *
+ *                absolute  Minimum change (in value units) that is reported.
+ *                relative  Minimum change in percent of the last reported value.
+ *
+ *                A field has changed if its sent value (after scaling and
+ *                rounding) differs and the change is at least absolute or
+ *                at least relative (a deadband of 0 is not used). Fields 
+ *                without deadband are reported on any change.
+ *
+ *                Example, report temperature changes of 0.5 °C or more
+ *                and battery voltage changes of 5% or more:
+ *                DEADBAND(temperature, 0.5, 0)
+ *                DEADBAND(batteryMv, 0, 5)
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef UPLINK_SCHEMA_H_
+#define UPLINK_SCHEMA_H_
+
+#define UPLINK_SCHEMA(FIELD) \
+    FIELD(counter, uint16_t, 16, 1, 0)
+
+#define UPLINK_DEADBANDS(DEADBAND) \
+    DEADBAND(counter, 5, 0)
+
+#endif  // UPLINK_SCHEMA_H_
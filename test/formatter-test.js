@@ -0,0 +1,126 @@
+/*******************************************************************************
+ *
+ *  File:         formatter-test.js
+ *
+ *  Function:     Tests for the uplink payload formatter.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Decodes the vectors in test/vectors with readBits(),
+ *                decodeDeltaSamples() and decodeXorSamples() from
+ *                payload-formatters/lmic-node-uplink-formatters.js.
+ *                The same vectors are encoded by BitWriter, DeltaCompressor
+ *                and XorCompressor in test/test_payload_encoding.
+ *
+ *                Run with: node test/formatter-test.js
+ *
+ ******************************************************************************/
+
+var assert = require("assert");
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+
+var formatter = {};
+vm.runInNewContext(fs.readFileSync(path.join(__dirname, "../payload-formatters/lmic-node-uplink-formatters.js"), "utf8"), formatter);
+
+
+function readVector(name) {
+    // Numbers in a .inc file, comments removed.
+    var text = fs.readFileSync(path.join(__dirname, "vectors", name), "utf8").replace(/\/\/.*$/gm, "");
+    return text.match(/-?0x[0-9A-Fa-f]+|-?[\d.]+(e[-+]?\d+)?/g).map(Number);
+}
+
+
+function bitVectorValues(signed) {
+    // Same values as bitVectorValues() in test/test_payload_encoding/test_main.cpp,
+    // but as decoded: signed values are negative numbers.
+    var state = 2463534242;
+    var vector = [];
+    for (var bits = 1; bits <= 32; bits++) {
+        state ^= state << 13;
+        state ^= state >>> 17;
+        state ^= state << 5;
+        state >>>= 0;
+        var range = Math.pow(2, bits);
+        var maximum = signed ? range / 2 - 1 : range - 1;
+        var minimum = signed ? -range / 2 : 0;
+        var random = state % range;
+        if (signed && random > maximum) {
+            random -= range;
+        }
+        [maximum, minimum, random].forEach(function (value) {
+            vector.push({ bits: bits, value: value });
+        });
+    }
+    return vector;
+}
+
+
+var tests = {
+    bitsUnsignedVector: function () {
+        var bytes = readVector("bits-unsigned.inc");
+        var offset = 0;
+        bitVectorValues(false).forEach(function (entry) {
+            assert.strictEqual(formatter.readBits(bytes, offset, entry.bits, false), entry.value,
+                               "bits " + entry.bits + " at offset " + offset);
+            offset += entry.bits;
+        });
+        assert.strictEqual(Math.ceil(offset / 8), bytes.length);
+    },
+
+    bitsSignedVector: function () {
+        var bytes = readVector("bits-signed.inc");
+        var offset = 0;
+        bitVectorValues(true).forEach(function (entry) {
+            assert.strictEqual(formatter.readBits(bytes, offset, entry.bits, true), entry.value,
+                               "bits " + entry.bits + " at offset " + offset);
+            offset += entry.bits;
+        });
+        assert.strictEqual(Math.ceil(offset / 8), bytes.length);
+    },
+
+    deltaVector: function () {
+        // Array.from(): the formatter runs in its own context, with its own Array.
+        var samples = Array.from(formatter.decodeDeltaSamples(readVector("delta-encoded.inc"), 0));
+        assert.deepStrictEqual(samples, readVector("delta-samples.inc"));
+    },
+
+    xorVector: function () {
+        // Samples are 32-bit floats on the node.
+        var samples = Array.from(formatter.decodeXorSamples(readVector("xor-encoded.inc"), 0));
+        assert.deepStrictEqual(samples, readVector("xor-samples.inc").map(Math.fround));
+    },
+
+    compressedBatchUplink: function () {
+        // fPort 12: sample interval (16 bits) followed by the delta compressed samples.
+        var bytes = [0x00, 0x3C].concat(readVector("delta-encoded.inc"));
+        var samples = readVector("delta-samples.inc");
+        var result = formatter.decodeUplink({ fPort: 12, bytes: bytes });
+        assert.strictEqual(result.data.interval, 60);
+        assert.strictEqual(result.data.samples.length, samples.length);
+        result.data.samples.forEach(function (sample, i) {
+            assert.strictEqual(sample.counter, samples[i]);
+            assert.strictEqual(sample.age, (samples.length - 1 - i) * 60);
+        });
+    }
+};
+
+
+var failures = 0;
+Object.keys(tests).forEach(function (name) {
+    try {
+        tests[name]();
+        console.log(name + ": PASS");
+    }
+    catch (error) {
+        console.log(name + ": FAIL " + error.message);
+        failures++;
+    }
+});
+console.log(Object.keys(tests).length + " tests, " + failures + " failures");
+process.exitCode = failures ? 1 : 0;
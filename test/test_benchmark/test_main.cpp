@@ -0,0 +1,149 @@
+/*******************************************************************************
+ *
+ *  File:         test_main.cpp
+ *
+ *  Function:     Benchmark for BitWriter, BitReader, DeltaCompressor and
+ *                XorCompressor.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Run with: pio test -e native -f test_benchmark -v
+ *
+ *                Prints the time per value on the development host. Useful
+ *                to compare changes to the encoders, not as an absolute
+ *                measure of the time taken on the MCU.
+ *
+ ******************************************************************************/
+
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "../../src/payload-encoding.h"
+
+const uint32_t BENCHMARK_ROUNDS = 20000;
+
+// Sink for results, so the compiler can not remove the work being measured.
+volatile uint32_t benchmarkSink;
+
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start, uint32_t values)
+{
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / values;
+}
+
+
+static void report(const char* name, double nanoseconds)
+{
+    char message[64];
+    snprintf(message, sizeof(message), "%-20s %7.2f ns/value", name, nanoseconds);
+    TEST_MESSAGE(message);
+}
+
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_benchmark_bits()
+{
+    // Values of 1-32 bits, written back to back (unaligned).
+    uint8_t buffer[200];
+    uint32_t values = 0;
+    uint32_t checksum = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+    {
+        BitWriter writer(buffer, sizeof(buffer));
+        for (uint8_t bits = 1; bits <= 32; ++bits)
+        {
+            writer.write(round * 2654435761UL, bits);
+        }
+        checksum += writer.length();
+        values += 32;
+    }
+    report("BitWriter::write", nanosecondsSince(start, values));
+
+    values = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+    {
+        BitReader reader(buffer, sizeof(buffer));
+        for (uint8_t bits = 1; bits <= 32; ++bits)
+        {
+            checksum += reader.readSigned(bits);
+        }
+        values += 32;
+    }
+    report("BitReader::readSigned", nanosecondsSince(start, values));
+
+    benchmarkSink = checksum;
+    TEST_ASSERT_TRUE(values > 0);
+}
+
+
+void test_benchmark_delta()
+{
+    // Slowly rising counter with some noise: mostly 1 byte, some 2 byte differences.
+    uint8_t buffer[255];
+    uint32_t values = 0;
+    uint32_t checksum = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+    {
+        DeltaCompressor compressor(buffer, sizeof(buffer));
+        int32_t sample = round;
+        while (compressor.add(sample))
+        {
+            sample += (sample * 7) % 97;
+        }
+        checksum += compressor.length();
+        values += compressor.count();
+    }
+    report("DeltaCompressor::add", nanosecondsSince(start, values));
+
+    benchmarkSink = checksum;
+    TEST_ASSERT_TRUE(values > 0);
+}
+
+
+void test_benchmark_xor()
+{
+    // Slowly changing temperature: mostly 2 or 3 bytes per sample.
+    uint8_t buffer[255];
+    uint32_t values = 0;
+    uint32_t checksum = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+    {
+        XorCompressor compressor(buffer, sizeof(buffer));
+        float sample = 20.0f + (round % 10);
+        while (compressor.add(sample))
+        {
+            sample += 0.25f;
+        }
+        checksum += compressor.length();
+        values += compressor.count();
+    }
+    report("XorCompressor::add", nanosecondsSince(start, values));
+
+    benchmarkSink = checksum;
+    TEST_ASSERT_TRUE(values > 0);
+}
+
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_bits);
+    RUN_TEST(test_benchmark_delta);
+    RUN_TEST(test_benchmark_xor);
+    return UNITY_END();
+}
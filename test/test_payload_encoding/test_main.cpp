@@ -0,0 +1,362 @@
+/*******************************************************************************
+ *
+ *  File:         test_main.cpp
+ *
+ *  Function:     Unit tests for BitWriter, BitReader, DeltaCompressor and
+ *                XorCompressor.
+ *
+ *  Copyright:    Copyright (c) 2026 LMIC-node contributors
+ *
+ *  License:      MIT License. See accompanying LICENSE file.
+ *
+ *  Author:       LMIC-node contributors
+ *
+ *  Description:  Run with: pio test -e native -f test_payload_encoding
+ *
+ *                The encoded output is also compared with the vectors in
+ *                test/vectors, which are decoded by the uplink formatter
+ *                in test/formatter-test.js (node test/formatter-test.js).
+ *                Together these check that the node and the formatter
+ *                agree on the format on air.
+ *
+ ******************************************************************************/
+
+#include <unity.h>
+#include "../../src/payload-encoding.h"
+
+
+// Values of the bit packing vectors: for each width (1-32 bits) the maximum,
+// the minimum and a pseudo random value. Must match bitVectorValues() in
+// test/formatter-test.js.
+
+const uint8_t BIT_VECTOR_COUNT = 32 * 3;
+
+const uint8_t bitVectorUnsigned[] = {
+    #include "../vectors/bits-unsigned.inc"
+};
+
+const uint8_t bitVectorSigned[] = {
+    #include "../vectors/bits-signed.inc"
+};
+
+const int32_t deltaVectorSamples[] = {
+    #include "../vectors/delta-samples.inc"
+};
+
+const uint8_t deltaVectorEncoded[] = {
+    #include "../vectors/delta-encoded.inc"
+};
+
+const float xorVectorSamples[] = {
+    #include "../vectors/xor-samples.inc"
+};
+
+const uint8_t xorVectorEncoded[] = {
+    #include "../vectors/xor-encoded.inc"
+};
+
+const uint8_t DELTA_VECTOR_COUNT = sizeof(deltaVectorSamples) / sizeof(deltaVectorSamples[0]);
+const uint8_t XOR_VECTOR_COUNT = sizeof(xorVectorSamples) / sizeof(xorVectorSamples[0]);
+
+
+static uint32_t xorshift32(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+
+static void bitVectorValues(bool isSigned, uint8_t* widths, uint32_t* values)
+{
+    // Values are returned as written: two's complement in the lower bits.
+    uint32_t state = 2463534242UL;
+    uint8_t index = 0;
+    for (uint8_t bits = 1; bits <= 32; ++bits)
+    {
+        uint32_t mask = bits == 32 ? 0xFFFFFFFFUL : (1UL << bits) - 1;
+        uint32_t maximum = isSigned ? mask >> 1 : mask;
+        uint32_t minimum = isSigned ? maximum + 1 : 0;
+        uint32_t random = xorshift32(state) & mask;
+        uint32_t kinds[3] = { maximum, minimum, random };
+        for (uint8_t kind = 0; kind < 3; ++kind)
+        {
+            widths[index] = bits;
+            values[index] = kinds[kind];
+            ++index;
+        }
+    }
+}
+
+
+static int32_t signExtend(uint32_t value, uint8_t bits)
+{
+    if (bits < 32 && (value >> (bits - 1)) & 1)
+    {
+        value |= 0xFFFFFFFFUL << bits;
+    }
+    return static_cast<int32_t>(value);
+}
+
+
+static uint8_t decodeXorSamples(const uint8_t* bytes, uint8_t length, uint32_t* samples, uint8_t maxSamples)
+{
+    // Same as decodeXorSamples() in the uplink formatter, returns the bit patterns.
+    uint32_t previous = 0;
+    uint8_t count = 0;
+    uint8_t i = 0;
+    while (i < length && count < maxSamples)
+    {
+        uint8_t leading = bytes[i] >> 4;
+        uint8_t meaningful = bytes[i++] & 0x0F;
+        uint32_t value = 0;
+        for (uint8_t n = 0; n < 4; ++n)
+        {
+            value = (value << 8) | ((n >= leading && n < leading + meaningful) ? bytes[i++] : 0);
+        }
+        previous ^= value;
+        samples[count++] = previous;
+    }
+    return count;
+}
+
+
+static uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_bits_round_trip_all_widths_and_offsets()
+{
+    uint8_t widths[BIT_VECTOR_COUNT];
+    uint32_t values[BIT_VECTOR_COUNT];
+    uint8_t buffer[8];
+    char message[64];
+
+    for (uint8_t isSigned = 0; isSigned <= 1; ++isSigned)
+    {
+        bitVectorValues(isSigned, widths, values);
+        for (uint8_t padding = 0; padding < 8; ++padding)
+        {
+            for (uint8_t i = 0; i < BIT_VECTOR_COUNT; ++i)
+            {
+                uint8_t bits = widths[i];
+                snprintf(message, sizeof(message), "bits %u, offset %u, signed %u", bits, padding, isSigned);
+
+                // Padding and a trailing marker check that neighbouring bits are not affected.
+                BitWriter writer(buffer, sizeof(buffer));
+                writer.write(0, padding);
+                if (isSigned)
+                {
+                    writer.writeSigned(signExtend(values[i], bits), bits);
+                }
+                else
+                {
+                    writer.write(values[i], bits);
+                }
+                writer.write(0x5, 3);
+                TEST_ASSERT_FALSE_MESSAGE(writer.overflow(), message);
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(padding + bits + 3, writer.bitLength(), message);
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE((padding + bits + 3 + 7) / 8, writer.length(), message);
+
+                BitReader reader(buffer, writer.length());
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, reader.read(padding), message);
+                if (isSigned)
+                {
+                    TEST_ASSERT_EQUAL_INT32_MESSAGE(signExtend(values[i], bits), reader.readSigned(bits), message);
+                }
+                else
+                {
+                    TEST_ASSERT_EQUAL_UINT32_MESSAGE(values[i], reader.read(bits), message);
+                }
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(0x5, reader.read(3), message);
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, reader.read(reader.remainingBits()), message);
+                TEST_ASSERT_FALSE_MESSAGE(reader.overflow(), message);
+            }
+        }
+    }
+}
+
+
+static void checkBitVector(bool isSigned, const uint8_t* expected, uint8_t expectedLength)
+{
+    uint8_t widths[BIT_VECTOR_COUNT];
+    uint32_t values[BIT_VECTOR_COUNT];
+    uint8_t buffer[255];
+    bitVectorValues(isSigned, widths, values);
+
+    // Values are written back to back, so they start at every bit offset.
+    BitWriter writer(buffer, sizeof(buffer));
+    for (uint8_t i = 0; i < BIT_VECTOR_COUNT; ++i)
+    {
+        writer.write(values[i], widths[i]);
+    }
+    TEST_ASSERT_FALSE(writer.overflow());
+    TEST_ASSERT_EQUAL_UINT32(expectedLength, writer.length());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, expectedLength);
+
+    BitReader reader(expected, expectedLength);
+    for (uint8_t i = 0; i < BIT_VECTOR_COUNT; ++i)
+    {
+        if (isSigned)
+        {
+            TEST_ASSERT_EQUAL_INT32(signExtend(values[i], widths[i]), reader.readSigned(widths[i]));
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL_UINT32(values[i], reader.read(widths[i]));
+        }
+    }
+    TEST_ASSERT_FALSE(reader.overflow());
+}
+
+
+void test_bits_unsigned_vector()
+{
+    checkBitVector(false, bitVectorUnsigned, sizeof(bitVectorUnsigned));
+}
+
+
+void test_bits_signed_vector()
+{
+    checkBitVector(true, bitVectorSigned, sizeof(bitVectorSigned));
+}
+
+
+void test_bits_overflow()
+{
+    uint8_t buffer[2];
+    BitWriter writer(buffer, sizeof(buffer));
+    TEST_ASSERT_FALSE(writer.write(0, 33));
+    TEST_ASSERT_TRUE(writer.overflow());
+    TEST_ASSERT_EQUAL_UINT32(0, writer.bitLength());
+    TEST_ASSERT_TRUE(writer.write(0xABC, 12));
+    TEST_ASSERT_FALSE(writer.write(0x1F, 5));       // Does not fit, nothing written
+    TEST_ASSERT_TRUE(writer.write(0xD, 4));
+    TEST_ASSERT_EQUAL_UINT32(16, writer.bitLength());
+    TEST_ASSERT_EQUAL_UINT8(0xAB, buffer[0]);
+    TEST_ASSERT_EQUAL_UINT8(0xCD, buffer[1]);
+
+    BitReader reader(buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_UINT32(0xABC, reader.read(12));
+    TEST_ASSERT_FALSE(reader.overflow());
+    TEST_ASSERT_EQUAL_UINT32(0, reader.read(5));
+    TEST_ASSERT_TRUE(reader.overflow());
+    TEST_ASSERT_EQUAL_UINT16(4, reader.remainingBits());
+    TEST_ASSERT_EQUAL_INT32(-3, reader.readSigned(4));
+}
+
+
+void test_delta_vector()
+{
+    uint8_t buffer[255];
+    DeltaCompressor compressor(buffer, sizeof(buffer));
+    int32_t previous = 0;
+    uint16_t length = 0;
+    for (uint8_t i = 0; i < DELTA_VECTOR_COUNT; ++i)
+    {
+        TEST_ASSERT_TRUE(compressor.add(deltaVectorSamples[i]));
+        length += DeltaCompressor::encodedLength(deltaVectorSamples[i], previous);
+        TEST_ASSERT_EQUAL_UINT32(length, compressor.length());
+        previous = deltaVectorSamples[i];
+    }
+    TEST_ASSERT_EQUAL_UINT32(DELTA_VECTOR_COUNT, compressor.count());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(deltaVectorEncoded), compressor.length());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(deltaVectorEncoded, buffer, sizeof(deltaVectorEncoded));
+}
+
+
+void test_delta_encoded_length()
+{
+    TEST_ASSERT_EQUAL_UINT8(1, DeltaCompressor::encodedLength(63, 0));
+    TEST_ASSERT_EQUAL_UINT8(1, DeltaCompressor::encodedLength(-64, 0));
+    TEST_ASSERT_EQUAL_UINT8(2, DeltaCompressor::encodedLength(64, 0));
+    TEST_ASSERT_EQUAL_UINT8(2, DeltaCompressor::encodedLength(-65, 0));
+    TEST_ASSERT_EQUAL_UINT8(2, DeltaCompressor::encodedLength(8191, 0));
+    TEST_ASSERT_EQUAL_UINT8(3, DeltaCompressor::encodedLength(-8193, 0));
+}
+
+
+void test_delta_full()
+{
+    uint8_t buffer[3];
+    DeltaCompressor compressor(buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(compressor.add(5));            // 1 byte
+    TEST_ASSERT_TRUE(compressor.add(105));          // 2 bytes
+    TEST_ASSERT_FALSE(compressor.add(106));         // Does not fit, nothing written
+    TEST_ASSERT_EQUAL_UINT32(3, compressor.length());
+    TEST_ASSERT_EQUAL_UINT32(2, compressor.count());
+}
+
+
+void test_xor_vector()
+{
+    uint8_t buffer[255];
+    XorCompressor compressor(buffer, sizeof(buffer));
+    for (uint8_t i = 0; i < XOR_VECTOR_COUNT; ++i)
+    {
+        TEST_ASSERT_TRUE(compressor.add(xorVectorSamples[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(XOR_VECTOR_COUNT, compressor.count());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(xorVectorEncoded), compressor.length());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(xorVectorEncoded, buffer, sizeof(xorVectorEncoded));
+}
+
+
+void test_xor_round_trip()
+{
+    // Bit exact, including negative zero, infinity and subnormal values.
+    const float samples[] = { 21.5f, 21.5f, -0.0f, 0.0f, 1.0f / 0.0f, 1e-45f, -273.15f, 1013.25f, 1013.5f };
+    const uint8_t count = sizeof(samples) / sizeof(samples[0]);
+    uint8_t buffer[64];
+    uint32_t decoded[count];
+    XorCompressor compressor(buffer, sizeof(buffer));
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        TEST_ASSERT_TRUE(compressor.add(samples[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(count, decodeXorSamples(buffer, compressor.length(), decoded, count));
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT32(floatBits(samples[i]), decoded[i]);
+    }
+}
+
+
+void test_xor_sizes_and_full()
+{
+    uint8_t buffer[4];
+    XorCompressor compressor(buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(compressor.add(0.0f));         // Equal to the initial 0: control byte only
+    TEST_ASSERT_EQUAL_UINT32(1, compressor.length());
+    TEST_ASSERT_TRUE(compressor.add(21.5f));        // 0x41AC0000: 2 bytes follow
+    TEST_ASSERT_EQUAL_UINT32(4, compressor.length());
+    TEST_ASSERT_FALSE(compressor.add(21.75f));      // Does not fit, nothing written
+    TEST_ASSERT_EQUAL_UINT32(4, compressor.length());
+    TEST_ASSERT_EQUAL_UINT32(2, compressor.count());
+}
+
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bits_round_trip_all_widths_and_offsets);
+    RUN_TEST(test_bits_unsigned_vector);
+    RUN_TEST(test_bits_signed_vector);
+    RUN_TEST(test_bits_overflow);
+    RUN_TEST(test_delta_vector);
+    RUN_TEST(test_delta_encoded_length);
+    RUN_TEST(test_delta_full);
+    RUN_TEST(test_xor_vector);
+    RUN_TEST(test_xor_round_trip);
+    RUN_TEST(test_xor_sizes_and_full);
+    return UNITY_END();
+}
@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""
+ File:         decode-binary-log.py
+
+ Function:     Decodes LMIC-node binary log records (USE_BINARY_LOG) to text.
+
+ Copyright:    Copyright (c) 2026 LMIC-node contributors
+
+ License:      MIT License. See accompanying LICENSE file.
+
+ Author:       LMIC-node contributors
+
+ Description:  Reads captured serial output from a file, stdin or a serial
+               port and prints each binary log record as a line of text.
+               Text in between records (e.g. the startup header) is passed
+               through unchanged. A sync byte that does not start a record
+               with a valid CRC is treated as text, so decoding resumes
+               at the next intact record after corrupted or dropped data.
+
+               Usage:
+               decode-binary-log.py capture.bin
+               decode-binary-log.py - < capture.bin
+               decode-binary-log.py --port /dev/ttyUSB0 --baud 115200   (requires pyserial)
+"""
+
+import argparse
+import struct
+import sys
+
+RECORD_SYNC = 0xA5
+RECORD_SIZE = 19
+RECORD_FORMAT = '<BIHHhhBBBH'     # After sync: code .. crc
+TIMESTAMP_WIDTH = 12
+
+LMIC_EVENTS = [
+    None, 'EV_SCAN_TIMEOUT', 'EV_BEACON_FOUND',
+    'EV_BEACON_MISSED', 'EV_BEACON_TRACKED', 'EV_JOINING',
+    'EV_JOINED', 'EV_RFU1', 'EV_JOIN_FAILED', 'EV_REJOIN_FAILED',
+    'EV_TXCOMPLETE', 'EV_LOST_TSYNC', 'EV_RESET',
+    'EV_RXCOMPLETE', 'EV_LINK_DEAD', 'EV_LINK_ALIVE', 'EV_SCAN_FOUND',
+    'EV_TXSTART', 'EV_TXCANCELED', 'EV_RXSTART', 'EV_JOIN_TXCOMPLETE'
+]
+
+LMIC_ERRORS = [
+    'LMIC_ERROR_SUCCESS', 'LMIC_ERROR_TX_BUSY', 'LMIC_ERROR_TX_TOO_LARGE',
+    'LMIC_ERROR_TX_NOT_FEASIBLE', 'LMIC_ERROR_TX_FAILED'
+]
+
+TXRX_FLAGS = [(0x80, 'ACK'), (0x40, 'NACK'), (0x20, 'NOPORT'), (0x10, 'PORT'),
+              (0x01, 'DNW1'), (0x02, 'DNW2'), (0x04, 'PING')]
+
+DO_WORK_STARTED = 0x80
+UPLINK_QUEUED = 0x81
+UPLINK_NOT_SCHEDULED = 0x82
+UPLINK_ERROR = 0x83
+DOWNLINK = 0x84
+SESSION_RESTORED = 0x85
+UPLINK_DROPPED = 0x86
+UPLINK_EXPIRED = 0x87
+INTERVAL_CHANGED = 0x88
+AIRTIME = 0x89
+NO_CHANGE = 0x8A
+NOT_ACKNOWLEDGED = 0x8B
+DATA_RATE_CHANGED = 0x8C
+JOIN_BACKOFF = 0x8D
+JOIN_REPORT = 0x8E
+SUB_BAND_CHANGED = 0x8F
+SAMPLE_DROPPED = 0x90
+USER = 0xC0
+
+
+def crc16(data):
+    # CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def format_flags(status):
+    names = [name for mask, name in TXRX_FLAGS if status & mask]
+    return ','.join(names) if names else '-'
+
+
+def format_record(record):
+    (code, timestamp, seqno_up, seqno_dn, rssi, snr_tenfold,
+     fport, length, status, _) = struct.unpack(RECORD_FORMAT, record[1:])
+    timestamp = str(timestamp).zfill(TIMESTAMP_WIDTH)
+    counters = 'Up: %d,  Down: %d' % (seqno_up, seqno_dn)
+
+    if code < len(LMIC_EVENTS) and LMIC_EVENTS[code] is not None:
+        text = 'Event: %s  %s  Flags: %s' % (LMIC_EVENTS[code], counters, format_flags(status))
+    elif code == DO_WORK_STARTED:
+        text = 'doWork job started'
+    elif code == UPLINK_QUEUED:
+        text = 'Packet queued  Port: %d  Length: %d' % (fport, length)
+    elif code == UPLINK_NOT_SCHEDULED:
+        text = 'Uplink not scheduled because TxRx pending'
+    elif code == UPLINK_ERROR:
+        error = LMIC_ERRORS[status] if status < len(LMIC_ERRORS) else str(-status)
+        text = 'LMIC Error: %s  Port: %d  Length: %d' % (error, fport, length)
+    elif code == DOWNLINK:
+        text = ('Downlink received  RSSI: %d dBm,  SNR: %.1f dB  Port: %d  Length: %d  Flags: %s'
+                % (rssi, snr_tenfold / 10.0, fport, length, format_flags(status)))
+    elif code == SESSION_RESTORED:
+        text = 'Session restored  %s' % counters
+    elif code == UPLINK_DROPPED:
+        if status:
+            text = 'Queued uplink not sent, message dropped  Port: %d  Length: %d  Attempts: %d' % (fport, length, status)
+        else:
+            text = 'Uplink queue full, message dropped  Port: %d  Length: %d' % (fport, length)
+    elif code == UPLINK_EXPIRED:
+        text = 'Queued uplink(s) expired: %d' % status
+    elif code == INTERVAL_CHANGED:
+        text = 'Interval changed'
+    elif code == AIRTIME:
+        text = 'Airtime: %d ms  Band: %d  24h: %d s' % (rssi, length, snr_tenfold)
+    elif code == NO_CHANGE:
+        text = 'No significant change, uplink skipped'
+    elif code == NOT_ACKNOWLEDGED:
+        text = 'Uplink not acknowledged  ACK success: %d%%  Retry: %s' % (length, status if status else '-')
+    elif code == DATA_RATE_CHANGED:
+        margin = 'margin: %d dB' % rssi if rssi >= 0 else 'link check not answered'
+        text = 'Data rate changed  DR: %d  TX power: %d dBm  %s' % (status, length, margin)
+    elif code == JOIN_BACKOFF:
+        text = 'Join backoff  Next attempt in %d s  DR: %d' % (rssi, status)
+    elif code == JOIN_REPORT:
+        text = 'Join attempts: %d  Latency: %d s  DR: %d' % (length, rssi, status)
+    elif code == SUB_BAND_CHANGED:
+        text = 'Sub-band changed  Next join attempts on sub-band %d' % status
+    elif code == SAMPLE_DROPPED:
+        text = 'Batch full, oldest sample dropped  Samples dropped: %d' % rssi
+    elif code >= USER:
+        text = 'User code 0x%02X  Port: %d  Length: %d  Status: %d' % (code, fport, length, status)
+    else:
+        text = 'Unknown Event (%d)' % code
+    return '%s:  %s' % (timestamp, text)
+
+
+class Decoder:
+    # Separates binary records from text in a byte stream.
+
+    def __init__(self, output):
+        self.output = output
+        self.buffer = bytearray()
+        self.text = bytearray()
+        self.line_start = True
+        self.crc_errors = 0
+
+    def write(self, text):
+        if text:
+            self.output.write(text)
+            self.line_start = text.endswith('\n')
+
+    def flush_text(self):
+        self.write(self.text.decode('ascii', errors='replace').replace('\r', ''))
+        self.text.clear()
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        while self.buffer:
+            if self.buffer[0] != RECORD_SYNC:
+                self.text.append(self.buffer.pop(0))
+                continue
+            if len(self.buffer) < RECORD_SIZE:
+                break
+            record = bytes(self.buffer[:RECORD_SIZE])
+            crc = record[-2] | (record[-1] << 8)
+            if crc16(record[1:-2]) != crc:
+                # Not a (complete) record: resynchronize on the next byte.
+                self.crc_errors += 1
+                self.text.append(self.buffer.pop(0))
+                continue
+            del self.buffer[:RECORD_SIZE]
+            self.flush_text()
+            if not self.line_start:
+                self.write('\n')
+            self.write(format_record(record) + '\n')
+        self.flush_text()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode LMIC-node binary log records.')
+    parser.add_argument('file', nargs='?', default='-',
+                        help='captured serial output, - for stdin (default)')
+    parser.add_argument('--port', help='read from serial port instead (requires pyserial)')
+    parser.add_argument('--baud', type=int, default=115200, help='serial port speed')
+    args = parser.parse_args()
+
+    decoder = Decoder(sys.stdout)
+    try:
+        if args.port:
+            import serial
+            with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+                while True:
+                    decoder.feed(port.read(256))
+                    sys.stdout.flush()
+        else:
+            source = sys.stdin.buffer if args.file == '-' else open(args.file, 'rb')
+            with source:
+                while True:
+                    data = source.read(4096)
+                    if not data:
+                        break
+                    decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+
+    if decoder.crc_errors:
+        sys.stderr.write('%d CRC errors\n' % decoder.crc_errors)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+ File:         generate-formatter.py
+
+ Function:     Generates the uplink payload decoder from the uplink payload schema.
+
+ Copyright:    Copyright (c) 2026 LMIC-node contributors
+
+ License:      MIT License. See accompanying LICENSE file.
+
+ Author:       LMIC-node contributors
+
+ Description:  Reads the UPLINK_SCHEMA fields from src/uplink-schema.h and
+               (re)generates function decodeSchemaPayload() in
+               payload-formatters/lmic-node-uplink-formatters.js, in between
+               the 'Generated' marker lines. The C++ encoder is derived from
+               the same schema at compile time, so encoder and decoder
+               cannot drift apart. The generated code uses readBits(),
+               which is defined in the formatter file.
+
+               Usage:
+               generate-formatter.py            Update the formatter file
+               generate-formatter.py --check    Only check if the formatter
+                                                is up to date (exit code 1 if not)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+SCHEMA_FILE = os.path.join(ROOT, 'src', 'uplink-schema.h')
+FORMATTER_FILE = os.path.join(ROOT, 'payload-formatters', 'lmic-node-uplink-formatters.js')
+
+BEGIN_MARKER = '// >>> Generated by tools/generate-formatter.py from src/uplink-schema.h, do not edit.'
+END_MARKER = '// <<< End of generated code.'
+
+FIELD_PATTERN = re.compile(
+    r'FIELD\(\s*(\w+)\s*,\s*([\w ]+?)\s*,\s*(\d+)\s*,\s*(-?[\d.]+)\s*,\s*(-?[\d.]+)\s*\)')
+UNSIGNED_TYPES = ('uint8_t', 'uint16_t', 'uint32_t', 'unsigned', 'bool', 'u1_t', 'u2_t', 'u4_t')
+
+
+def parse_schema(text):
+    # Returns the fields of the UPLINK_SCHEMA macro as
+    # (name, signed, bits, scale, offset) tuples.
+    match = re.search(r'#define\s+UPLINK_SCHEMA\(FIELD\)((?:.*\\\n)*.*)', text)
+    if not match:
+        raise ValueError('UPLINK_SCHEMA not found')
+    fields = []
+    for name, ctype, bits, scale, offset in FIELD_PATTERN.findall(match.group(1)):
+        bits = int(bits)
+        if not 1 <= bits <= 32:
+            raise ValueError('field %s: bits must be 1-32' % name)
+        signed = not (ctype.startswith('unsigned') or ctype in UNSIGNED_TYPES)
+        fields.append((name, signed, bits, scale, offset))
+    if not fields:
+        raise ValueError('UPLINK_SCHEMA has no fields')
+    return fields
+
+
+def generate(fields):
+    total_bits = sum(field[2] for field in fields)
+    lines = [
+        BEGIN_MARKER,
+        'function decodeSchemaPayload(bytes) {',
+        '    // Payload length: %d bytes (%d bits).' % ((total_bits + 7) // 8, total_bits),
+        '    return {',
+    ]
+    offset = 0
+    for index, (name, signed, bits, scale, value_offset) in enumerate(fields):
+        expression = 'readBits(bytes, %d, %d, %s)' % (offset, bits, 'true' if signed else 'false')
+        if float(scale) != 1:
+            expression += ' / %s' % scale
+        if float(value_offset) != 0:
+            expression += ' + %s' % value_offset if not value_offset.startswith('-') \
+                          else ' - %s' % value_offset[1:]
+        separator = ',' if index < len(fields) - 1 else ''
+        lines.append('        %s: %s%s' % (name, expression, separator))
+        offset += bits
+    lines += [
+        '    };',
+        '}',
+        'var schemaPayloadLength = %d;' % ((total_bits + 7) // 8),
+        END_MARKER,
+    ]
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the uplink decoder from the uplink schema.')
+    parser.add_argument('--check', action='store_true',
+                        help='only check if the formatter is up to date')
+    args = parser.parse_args()
+
+    with open(SCHEMA_FILE) as f:
+        fields = parse_schema(f.read())
+    with open(FORMATTER_FILE) as f:
+        formatter = f.read()
+
+    begin = formatter.find(BEGIN_MARKER)
+    end = formatter.find(END_MARKER)
+    if begin < 0 or end < begin:
+        sys.exit('Generated code markers not found in %s' % FORMATTER_FILE)
+    updated = formatter[:begin] + generate(fields) + formatter[end + len(END_MARKER):]
+
+    if args.check:
+        if updated != formatter:
+            sys.exit('%s is not up to date, run tools/generate-formatter.py' % FORMATTER_FILE)
+        print('Formatter is up to date.')
+    elif updated != formatter:
+        with open(FORMATTER_FILE, 'w') as f:
+            f.write(updated)
+        print('Updated %s' % os.path.relpath(FORMATTER_FILE))
+    else:
+        print('Formatter is up to date.')
+
+
+if __name__ == '__main__':
+    main()